@@ -24,9 +24,12 @@
 #include "autocmd.h"
 #include "ascii.h"
 #include "ex.h"
+#include "pattern-set.h"
 #include "util.h"
 #include "completion.h"
 
+extern struct Vimb vb;
+
 typedef struct {
     guint bits;     /* the bits identify the events the command applies to */
     char *excmd;    /* ex command string to be run on matches event */
@@ -34,12 +37,22 @@ typedef struct {
 } AutoCmd;
 
 struct AuGroup {
-    char    *name;
-    GSList  *cmds;
+    char       *name;
+    GSList     *cmds;       /* all commands in the order they where added */
+    PatternSet *patterns;   /* the patterns of the commands */
 };
 
 typedef struct AuGroup AuGroup;
 
+/* The autocmd groups that might be shared by multiple clients. */
+struct AuTable {
+    GSList *groups;
+    guint  usedbits;    /* holds all used event bits */
+    int    refcount;
+};
+
+typedef struct AuTable AuTable;
+
 static struct {
     const char *name;
     guint      bits;
@@ -55,28 +68,43 @@ static struct {
     {"DownloadFailed",   0x0080},
 };
 
-static GSList *get_group(Client *c, const char *name);
+/* The autocmds defined by the config file, which are shared by all clients
+ * that did not change their autocmds locally. */
+static AuTable *shared = NULL;
+
+static GSList *get_group(AuTable *table, const char *name);
 static guint get_event_bits(Client *c, const char *name);
-static void rebuild_used_bits(Client *c);
+static AuTable *get_table(Client *c);
+static void rebuild_used_bits(AuTable *table);
+static void group_add_cmd(AuGroup *grp, AutoCmd *cmd);
+static void group_remove_cmd(AuGroup *grp, GSList *link);
 static char *get_next_word(char **line);
 static AuGroup *new_group(const char *name);
 static void free_group(AuGroup *group);
 static AutoCmd *new_autocmd(const char *excmd, const char *pattern);
 static void free_autocmd(AutoCmd *cmd);
+static void table_unref(AuTable *table);
 
 
 void autocmd_init(Client *c)
 {
-    c->autocmd.curgroup = new_group("end");
-    c->autocmd.groups   = g_slist_prepend(c->autocmd.groups, c->autocmd.curgroup);
-    c->autocmd.usedbits = 0;
+    if (!shared) {
+        shared         = g_slice_new0(AuTable);
+        shared->groups = g_slist_prepend(NULL, new_group("end"));
+    }
+    shared->refcount++;
+
+    c->autocmd.table    = shared;
+    c->autocmd.curgroup = NULL;
 }
 
 void autocmd_cleanup(Client *c)
 {
-    if (c->autocmd.groups) {
-        g_slist_free_full(c->autocmd.groups, (GDestroyNotify)free_group);
+    if (c->autocmd.table) {
+        table_unref(c->autocmd.table);
+        c->autocmd.table = NULL;
     }
+    g_free(c->autocmd.curgroup);
 }
 
 /**
@@ -85,6 +113,7 @@ void autocmd_cleanup(Client *c)
 gboolean autocmd_augroup(Client *c, char *name, gboolean delete)
 {
     GSList *item;
+    AuTable *table;
 
     if (!*name) {
         return false;
@@ -92,11 +121,12 @@ gboolean autocmd_augroup(Client *c, char *name, gboolean delete)
 
     /* check for group "end" that marks the default group */
     if (!strcmp(name, "end")) {
-        c->autocmd.curgroup = (AuGroup*)c->autocmd.groups->data;
+        g_free(c->autocmd.curgroup);
+        c->autocmd.curgroup = NULL;
         return true;
     }
 
-    item = get_group(c, name);
+    item = get_group(c->autocmd.table, name);
 
     /* check if the group is going to be removed */
     if (delete) {
@@ -104,35 +134,33 @@ gboolean autocmd_augroup(Client *c, char *name, gboolean delete)
         if (!item) {
             return true;
         }
-        if (c->autocmd.curgroup == (AuGroup*)item->data) {
+        if (c->autocmd.curgroup && !strcmp(c->autocmd.curgroup, name)) {
             /* if the group to delete is the current - switch the the default
              * group after removing it */
-            c->autocmd.curgroup = (AuGroup*)c->autocmd.groups->data;
+            g_free(c->autocmd.curgroup);
+            c->autocmd.curgroup = NULL;
         }
 
         /* now remove the group */
+        table = get_table(c);
+        item  = get_group(table, name);
         free_group((AuGroup*)item->data);
-        c->autocmd.groups = g_slist_delete_link(c->autocmd.groups, item);
+        table->groups = g_slist_delete_link(table->groups, item);
 
         /* there where autocmds remove - so recreate the usedbits */
-        rebuild_used_bits(c);
+        rebuild_used_bits(table);
 
         return true;
     }
 
-    /* check if the group does already exists */
-    if (item) {
-        /* if the group is found in the known groups use it as current */
-        c->autocmd.curgroup = (AuGroup*)item->data;
-
-        return true;
+    /* create a new group if it does not exist yet */
+    if (!item) {
+        table         = get_table(c);
+        table->groups = g_slist_prepend(table->groups, new_group(name));
     }
 
-    /* create a new group and use it as current */
-    c->autocmd.curgroup = new_group(name);
-
-    /* append it to known groups */
-    c->autocmd.groups = g_slist_prepend(c->autocmd.groups, c->autocmd.curgroup);
+    /* use the group as current */
+    OVERWRITE_STRING(c->autocmd.curgroup, name);
 
     return true;
 }
@@ -147,26 +175,24 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
 {
     guint bits;
     char *parse, *word, *pattern, *excmd;
+    const char *group = NULL;
     GSList *item;
-    AuGroup *grp = NULL;
+    AuTable *table;
+    AuGroup *grp;
 
     parse = name;
 
     /* parse group name if it's there */
     word = get_next_word(&parse);
-    if (word) {
-        /* check if the word is a known group name */
-        item = get_group(c, word);
-        if (item) {
-            grp = (AuGroup*)item->data;
+    if (word && get_group(c->autocmd.table, word)) {
+        group = word;
 
-            /* group is found - get the next word */
-            word = get_next_word(&parse);
-        }
+        /* group is found - get the next word */
+        word = get_next_word(&parse);
     }
-    if (!grp) {
+    if (!group) {
         /* no group found - use the current one */
-        grp = c->autocmd.curgroup;
+        group = c->autocmd.curgroup ? c->autocmd.curgroup : "end";
     }
 
     /* parse event name - if none was matched run it for all events */
@@ -189,15 +215,24 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
     }
     excmd = parse;
 
+    table = get_table(c);
+    item  = get_group(table, group);
+    grp   = item ? (AuGroup*)item->data : NULL;
+
     /* delete the autocmd if bang was given */
     if (delete) {
-        GSList *lc;
+        GSList *lc, *next;
         AutoCmd *cmd;
         gboolean removed = false;
 
+        if (!grp) {
+            return true;
+        }
+
         /* check if the group does already exists */
-        for (lc = grp->cmds; lc; lc = lc->next) {
-            cmd = (AutoCmd*)lc->data;
+        for (lc = grp->cmds; lc; lc = next) {
+            next = lc->next;
+            cmd  = (AutoCmd*)lc->data;
             /* if not bits match - skip the command */
             if (!(cmd->bits & bits)) {
                 continue;
@@ -211,7 +246,7 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
             cmd->bits &= ~bits;
 
             /* if the command has no matching events - remove it */
-            grp->cmds = g_slist_delete_link(grp->cmds, lc);
+            group_remove_cmd(grp, lc);
             free_autocmd(cmd);
 
             removed = true;
@@ -219,7 +254,7 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
 
         /* if ther was at least one command removed - rebuilt the used bits */
         if (removed) {
-            rebuild_used_bits(c);
+            rebuild_used_bits(table);
         }
 
         return true;
@@ -231,10 +266,10 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
         cmd->bits    = bits;
 
         /* add the new autocmd to the group */
-        grp->cmds = g_slist_append(grp->cmds, cmd);
+        group_add_cmd(grp, cmd);
 
         /* merge the autocmd bits into the used bits */
-        c->autocmd.usedbits |= cmd->bits;
+        table->usedbits |= cmd->bits;
     }
 
     return true;
@@ -245,42 +280,48 @@ gboolean autocmd_add(Client *c, char *name, gboolean delete)
  */
 gboolean autocmd_run(Client *c, AuEvent event, const char *uri, const char *group)
 {
-    GSList  *lg, *lc;
+    GSList  *lg, *lc, *cands;
     AuGroup *grp;
     AutoCmd *cmd;
-    guint bits = events[event].bits;
+    AuTable *table = c->autocmd.table;
+    guint bits     = events[event].bits;
 
     /* if there is no autocmd for this event - skip here */
-    if (!(c->autocmd.usedbits & bits)) {
+    if (!(table->usedbits & bits)) {
         return true;
     }
 
+    /* keep the table alive even if the commands make the client to use an
+     * own copy of the autocmds */
+    table->refcount++;
+
     /* loop over the groups and find matching commands */
-    for (lg = c->autocmd.groups; lg; lg = lg->next) {
+    for (lg = table->groups; lg; lg = lg->next) {
         grp = lg->data;
         /* if a group was given - skip all none matching groupes */
         if (group && strcmp(group, grp->name)) {
             continue;
         }
-        /* test each command in group */
-        for (lc = grp->cmds; lc; lc = lc->next) {
+        /* get the commands with matching pattern - or all if no uri was
+         * given - work on a own list because the commands might change the
+         * group */
+        cands = uri ? pattern_set_match(grp->patterns, uri) : g_slist_copy(grp->cmds);
+        for (lc = cands; lc; lc = lc->next) {
             cmd = lc->data;
             /* skip if this dos not match the event bits */
             if (!(bits & cmd->bits)) {
                 continue;
             }
-            /* check pattern only if uri was given */
-            /* skip if pattern does not match */
-            if (uri && !util_wildmatch(cmd->pattern, uri)) {
-                continue;
-            }
             /* run the command */
             /* TODO shoult the result be tested for RESULT_COMPLETE? */
             /* run command and make sure it's not writte to command history */
             ex_run_string(c, cmd->excmd, false);
         }
+        g_slist_free(cands);
     }
 
+    table_unref(table);
+
     return true;
 }
 
@@ -291,13 +332,13 @@ gboolean autocmd_fill_group_completion(Client *c, GtkListStore *store, const cha
     GtkTreeIter iter;
 
     if (!input || !*input) {
-        for (lg = c->autocmd.groups; lg; lg = lg->next) {
+        for (lg = c->autocmd.table->groups; lg; lg = lg->next) {
             gtk_list_store_append(store, &iter);
             gtk_list_store_set(store, &iter, COMPLETION_STORE_FIRST, ((AuGroup*)lg->data)->name, -1);
             found = true;
         }
     } else {
-        for (lg = c->autocmd.groups; lg; lg = lg->next) {
+        for (lg = c->autocmd.table->groups; lg; lg = lg->next) {
             char *value = ((AuGroup*)lg->data)->name;
             if (g_str_has_prefix(value, input)) {
                 gtk_list_store_append(store, &iter);
@@ -340,12 +381,12 @@ gboolean autocmd_fill_event_completion(Client *c, GtkListStore *store, const cha
 /**
  * Get the augroup by it's name.
  */
-static GSList *get_group(Client *c, const char *name)
+static GSList *get_group(AuTable *table, const char *name)
 {
     GSList  *lg;
     AuGroup *grp;
 
-    for (lg = c->autocmd.groups; lg; lg = lg->next) {
+    for (lg = table->groups; lg; lg = lg->next) {
         grp = lg->data;
         if (!strcmp(grp->name, name)) {
             return lg;
@@ -396,28 +437,84 @@ static guint get_event_bits(Client *c, const char *name)
     return result;
 }
 
+/**
+ * Returns the autocmds of the client that are going to be changed. Changes
+ * done by the config file are applied to the shared autocmds. For all other
+ * changes the client gets an own copy of the autocmds.
+ */
+static AuTable *get_table(Client *c)
+{
+    GSList *lg, *lc;
+    AuTable *table;
+    AuGroup *grp, *copy;
+    AutoCmd *cmd;
+
+    if (c->autocmd.table != shared || vb.in_config) {
+        return c->autocmd.table;
+    }
+
+    table           = g_slice_new0(AuTable);
+    table->usedbits = shared->usedbits;
+    table->refcount = 1;
+    for (lg = shared->groups; lg; lg = lg->next) {
+        grp  = (AuGroup*)lg->data;
+        copy = new_group(grp->name);
+        for (lc = grp->cmds; lc; lc = lc->next) {
+            cmd       = new_autocmd(((AutoCmd*)lc->data)->excmd, ((AutoCmd*)lc->data)->pattern);
+            cmd->bits = ((AutoCmd*)lc->data)->bits;
+            group_add_cmd(copy, cmd);
+        }
+        table->groups = g_slist_prepend(table->groups, copy);
+    }
+    table->groups = g_slist_reverse(table->groups);
+
+    table_unref(c->autocmd.table);
+    c->autocmd.table = table;
+
+    return table;
+}
+
 /**
  * Rebuild the usedbits from scratch.
  * Save all used autocmd event bits in the bitmap.
  */
-static void rebuild_used_bits(Client *c)
+static void rebuild_used_bits(AuTable *table)
 {
     GSList *lc, *lg;
     AuGroup *grp;
 
     /* clear the current set bits */
-    c->autocmd.usedbits = 0;
+    table->usedbits = 0;
     /* loop over the groups */
-    for (lg = c->autocmd.groups; lg; lg = lg->next) {
+    for (lg = table->groups; lg; lg = lg->next) {
         grp = (AuGroup*)lg->data;
 
         /* merge the used event bints into the bitmap */
         for (lc = grp->cmds; lc; lc = lc->next) {
-            c->autocmd.usedbits |= ((AutoCmd*)lc->data)->bits;
+            table->usedbits |= ((AutoCmd*)lc->data)->bits;
         }
     }
 }
 
+/**
+ * Adds the command to the end of the group.
+ */
+static void group_add_cmd(AuGroup *grp, AutoCmd *cmd)
+{
+    grp->cmds = g_slist_append(grp->cmds, cmd);
+    pattern_set_add(grp->patterns, cmd->pattern, cmd);
+}
+
+/**
+ * Removes the command of given list item from the group. The command itself
+ * is not freed.
+ */
+static void group_remove_cmd(AuGroup *grp, GSList *link)
+{
+    pattern_set_remove(grp->patterns, link->data);
+    grp->cmds = g_slist_delete_link(grp->cmds, link);
+}
+
 /**
  * Get the next word from given line.
  * Given line pointer is set past the word and and a 0-byte is added there.
@@ -453,9 +550,9 @@ static char *get_next_word(char **line)
 
 static AuGroup *new_group(const char *name)
 {
-    AuGroup *new = g_slice_new(AuGroup);
-    new->name    = g_strdup(name);
-    new->cmds    = NULL;
+    AuGroup *new  = g_slice_new0(AuGroup);
+    new->name     = g_strdup(name);
+    new->patterns = pattern_set_new();
 
     return new;
 }
@@ -463,6 +560,7 @@ static AuGroup *new_group(const char *name)
 static void free_group(AuGroup *group)
 {
     g_free(group->name);
+    pattern_set_free(group->patterns);
     if (group->cmds) {
         g_slist_free_full(group->cmds, (GDestroyNotify)free_autocmd);
     }
@@ -484,4 +582,16 @@ static void free_autocmd(AutoCmd *cmd)
     g_slice_free(AutoCmd, cmd);
 }
 
+static void table_unref(AuTable *table)
+{
+    if (--table->refcount > 0) {
+        return;
+    }
+    if (table == shared) {
+        shared = NULL;
+    }
+    g_slist_free_full(table->groups, (GDestroyNotify)free_group);
+    g_slice_free(AuTable, table);
+}
+
 #endif
@@ -32,6 +32,7 @@
 #include "history.h"
 #include "util.h"
 #include "main.h"
+#include "setting.h"
 
 typedef struct {
     Client   *c;
@@ -23,6 +23,7 @@
  */
 
 #include <JavaScriptCore/JavaScript.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <sys/wait.h>
 
@@ -102,6 +103,19 @@ typedef struct {
 
 typedef VbCmdResult (*ExFunc)(Client *c, const ExArg *arg);
 
+typedef struct {
+    char   *line;        /* the line as written in the file */
+    GSList *args;        /* parsed commands of the line or NULL if the line
+                            must be parsed again on each run */
+} ExLine;
+
+typedef struct {
+    time_t mtime;        /* modification time of the file on parsing */
+    off_t  size;         /* size of the file on parsing */
+    GSList *lines;       /* list of ExLine */
+    int    refcount;
+} ExFile;
+
 typedef struct {
     const char *name;         /* full name of the command even if called abbreviated */
     ExCode    code;           /* constant id for the command */
@@ -120,16 +134,29 @@ static struct {
     Phase phase; /* current parsing phase */
 } info = {'\0', PHASE_START};
 
+/* Parsed config files keyed by their path. This allows to setup new clients
+ * without the need to parse the config and sourced files again. */
+static GHashTable *files = NULL;
+
 static void input_activate(Client *c);
-static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist);
+static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist,
+        gboolean quiet);
 static gboolean parse_count(const char **input, ExArg *arg);
-static gboolean parse_command_name(Client *c, const char **input, ExArg *arg);
+static gboolean parse_command_name(Client *c, const char **input, ExArg *arg,
+        gboolean quiet);
 static gboolean parse_bang(const char **input, ExArg *arg);
 static gboolean parse_lhs(const char **input, ExArg *arg);
 static gboolean parse_rhs(Client *c, const char **input, ExArg *arg);
 static void skip_whitespace(const char **input);
+static ExArg *new_cmdarg(void);
+static ExArg *copy_cmdarg(const ExArg *arg);
 static void free_cmdarg(ExArg *arg);
 static VbCmdResult execute(Client *c, const ExArg *arg);
+static ExFile *file_get(Client *c, const char *filename);
+static ExLine *file_parse_line(Client *c, const char *line);
+static VbCmdResult file_run_line(Client *c, const ExLine *line, ExArg *arg);
+static void file_unref(ExFile *file);
+static void free_line(ExLine *line);
 
 #ifdef FEATURE_AUTOCMD
 static VbCmdResult ex_augroup(Client *c, const ExArg *arg);
@@ -137,7 +164,7 @@ static VbCmdResult ex_autocmd(Client *c, const ExArg *arg);
 #endif
 static VbCmdResult ex_bookmark(Client *c, const ExArg *arg);
 static VbCmdResult ex_eval(Client *c, const ExArg *arg);
-static void on_eval_script_finished(GDBusProxy *proxy, GAsyncResult *result, Client *c);
+static void on_eval_script_finished(Client *c, GVariant *result, gpointer data);
 static VbCmdResult ex_clearcache(Client *c, const ExArg *arg);
 static VbCmdResult ex_hardcopy(Client *c, const ExArg *arg);
 static void print_failed_cb(WebKitPrintOperation* op, GError *err, Client *c);
@@ -463,48 +490,55 @@ gboolean ex_fill_completion(GtkListStore *store, const char *input)
 }
 
 /**
- * Run all ex commands from a file.
+ * Runs the commands of given file. The parsed commands are cached so that
+ * following calls for the same unchanged file do not need to read and parse
+ * the file again.
  */
 VbCmdResult ex_run_file(Client *c, const char *filename)
 {
-    int length, i;
-    char *line, **lines;
+    GSList *l;
+    ExLine *line;
+    ExFile *file;
+    ExArg *arg;
     VbCmdResult res = CMD_SUCCESS;
 
-    lines = util_get_lines(filename);
-    if (!lines) {
+    file = file_get(c, filename);
+    if (!file) {
         return res;
     }
 
-    length = g_strv_length(lines) - 1;
-    for (i = 0; i < length; i++) {
-        line = lines[i];
-        /* skip commented or empty lines */
-        if (*line == '#' || !*line) {
-            continue;
-        }
-        if ((ex_run_string(c, line, FALSE) & ~CMD_KEEPINPUT) == CMD_ERROR) {
+    arg = new_cmdarg();
+    for (l = file->lines; l; l = l->next) {
+        line = l->data;
+        if ((file_run_line(c, line, arg) & ~CMD_KEEPINPUT) == CMD_ERROR) {
             res = CMD_ERROR | CMD_KEEPINPUT;
-            g_warning("Invalid command in %s: '%s'", filename, line);
+            g_warning("Invalid command in %s: '%s'", filename, line->line);
         }
     }
-    g_strfreev(lines);
+    free_cmdarg(arg);
+    file_unref(file);
 
     return res;
 }
 
+void ex_cleanup(void)
+{
+    if (files) {
+        g_hash_table_destroy(files);
+        files = NULL;
+    }
+}
+
 VbCmdResult ex_run_string(Client *c, const char *input, gboolean enable_history)
 {
     /* copy to have original command for history */
     const char *in  = input;
     gboolean nohist = FALSE;
     VbCmdResult res = CMD_ERROR | CMD_KEEPINPUT;
-    ExArg *arg = g_slice_new0(ExArg);
-    arg->lhs   = g_string_new("");
-    arg->rhs   = g_string_new("");
+    ExArg *arg      = new_cmdarg();
 
     while (in && *in) {
-        if (!parse(c, &in, arg, &nohist) || !(res = execute(c, arg))) {
+        if (!parse(c, &in, arg, &nohist, FALSE) || !(res = execute(c, arg))) {
             break;
         }
     }
@@ -560,8 +594,11 @@ static void input_activate(Client *c)
 
 /**
  * Parses given input string into given ExArg pointer.
+ *
+ * @quiet: If TRUE unknown commands are not reported to the user.
  */
-static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist)
+static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohist,
+        gboolean quiet)
 {
     if (!*input || !**input) {
         return FALSE;
@@ -581,7 +618,7 @@ static gboolean parse(Client *c, const char **input, ExArg *arg, gboolean *nohis
     parse_count(input, arg);
 
     skip_whitespace(input);
-    if (!parse_command_name(c, input, arg)) {
+    if (!parse_command_name(c, input, arg, quiet)) {
         return FALSE;
     }
 
@@ -625,7 +662,8 @@ static gboolean parse_count(const char **input, ExArg *arg)
 /**
  * Parse the command name from given input.
  */
-static gboolean parse_command_name(Client *c, const char **input, ExArg *arg)
+static gboolean parse_command_name(Client *c, const char **input, ExArg *arg,
+        gboolean quiet)
 {
     int len      = 0;
     int first    = 0;   /* number of first found command */
@@ -663,7 +701,9 @@ static gboolean parse_command_name(Client *c, const char **input, ExArg *arg)
         }
         cmd[len] = '\0';
 
-        vb_echo(c, MSG_ERROR, TRUE, "Unknown command: %s", cmd);
+        if (!quiet) {
+            vb_echo(c, MSG_ERROR, TRUE, "Unknown command: %s", cmd);
+        }
         return FALSE;
     }
 
@@ -783,6 +823,24 @@ static void skip_whitespace(const char **input)
     }
 }
 
+static ExArg *new_cmdarg(void)
+{
+    ExArg *arg = g_slice_new0(ExArg);
+    arg->lhs   = g_string_new("");
+    arg->rhs   = g_string_new("");
+
+    return arg;
+}
+
+static ExArg *copy_cmdarg(const ExArg *arg)
+{
+    ExArg *copy = g_slice_dup(ExArg, arg);
+    copy->lhs   = g_string_new_len(arg->lhs->str, arg->lhs->len);
+    copy->rhs   = g_string_new_len(arg->rhs->str, arg->rhs->len);
+
+    return copy;
+}
+
 static void free_cmdarg(ExArg *arg)
 {
     if (arg->lhs) {
@@ -794,6 +852,140 @@ static void free_cmdarg(ExArg *arg)
     g_slice_free(ExArg, arg);
 }
 
+/**
+ * Retrieves the parsed file from cache or reads and parses the file if it is
+ * not cached yet or was changed since it was parsed. The returned file must
+ * be released by file_unref().
+ */
+static ExFile *file_get(Client *c, const char *filename)
+{
+    int i, length;
+    char **lines;
+    ExFile *file;
+    GStatBuf st;
+
+    if (g_stat(filename, &st)) {
+        return NULL;
+    }
+
+    if (!files) {
+        files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                (GDestroyNotify)file_unref);
+    }
+
+    file = g_hash_table_lookup(files, filename);
+    if (file && file->mtime == st.st_mtime && file->size == st.st_size) {
+        file->refcount++;
+        return file;
+    }
+
+    lines = util_get_lines(filename);
+    if (!lines) {
+        return NULL;
+    }
+
+    file           = g_slice_new0(ExFile);
+    file->mtime    = st.st_mtime;
+    file->size     = st.st_size;
+    file->refcount = 2; /* one for the cache and one for the caller */
+
+    length = g_strv_length(lines) - 1;
+    for (i = 0; i < length; i++) {
+        /* skip commented or empty lines */
+        if (*lines[i] == '#' || !*lines[i]) {
+            continue;
+        }
+        file->lines = g_slist_prepend(file->lines, file_parse_line(c, lines[i]));
+    }
+    file->lines = g_slist_reverse(file->lines);
+    g_strfreev(lines);
+
+    /* a previous version of the file might still be in use by a running
+     * ex_run_file() - so this does only drop the reference of the cache */
+    g_hash_table_replace(files, g_strdup(filename), file);
+
+    return file;
+}
+
+/**
+ * Parses all the commands of given line without executing them. Lines that
+ * could not be parsed or that contain commands with expansion, which depend
+ * on the state at the time they are run, are not stored as parsed commands
+ * and are parsed again each time the line is run. Parse errors are not
+ * reported here but when the line is run.
+ */
+static ExLine *file_parse_line(Client *c, const char *line)
+{
+    const char *in  = line;
+    gboolean nohist = FALSE;
+    ExArg *arg      = new_cmdarg();
+    ExLine *exline  = g_slice_new0(ExLine);
+
+    exline->line = g_strdup(line);
+    while (in && *in) {
+        if (!parse(c, &in, arg, &nohist, TRUE) || arg->flags & EX_FLAG_EXP) {
+            g_slist_free_full(exline->args, (GDestroyNotify)free_cmdarg);
+            exline->args = NULL;
+            break;
+        }
+        exline->args = g_slist_prepend(exline->args, copy_cmdarg(arg));
+    }
+    exline->args = g_slist_reverse(exline->args);
+    free_cmdarg(arg);
+
+    return exline;
+}
+
+/**
+ * Runs the commands of a line of a parsed file. Given arg is used as buffer
+ * for the commands, because the commands are allowed to change the lhs and
+ * rhs of the arg.
+ */
+static VbCmdResult file_run_line(Client *c, const ExLine *line, ExArg *arg)
+{
+    GSList *l;
+    const ExArg *parsed;
+    VbCmdResult res = CMD_ERROR | CMD_KEEPINPUT;
+
+    if (!line->args) {
+        return ex_run_string(c, line->line, FALSE);
+    }
+
+    for (l = line->args; l; l = l->next) {
+        parsed     = l->data;
+        arg->count = parsed->count;
+        arg->idx   = parsed->idx;
+        arg->name  = parsed->name;
+        arg->code  = parsed->code;
+        arg->bang  = parsed->bang;
+        arg->flags = parsed->flags;
+        g_string_assign(arg->lhs, parsed->lhs->str);
+        g_string_assign(arg->rhs, parsed->rhs->str);
+
+        if (!(res = execute(c, arg))) {
+            break;
+        }
+    }
+
+    return res;
+}
+
+static void file_unref(ExFile *file)
+{
+    if (--file->refcount > 0) {
+        return;
+    }
+    g_slist_free_full(file->lines, (GDestroyNotify)free_line);
+    g_slice_free(ExFile, file);
+}
+
+static void free_line(ExLine *line)
+{
+    g_slist_free_full(line->args, (GDestroyNotify)free_cmdarg);
+    g_free(line->line);
+    g_slice_free(ExLine, line);
+}
+
 #ifdef FEATURE_AUTOCMD
 static VbCmdResult ex_augroup(Client *c, const ExArg *arg)
 {
@@ -827,22 +1019,21 @@ static VbCmdResult ex_eval(Client *c, const ExArg *arg)
 {
     /* Called as :eval! - don't print to inputbox. */
     if (arg->bang) {
-        ext_proxy_eval_script(c, arg->rhs->str, NULL);
+        ext_proxy_eval_script(c, arg->rhs->str, NULL, NULL);
     } else {
-        ext_proxy_eval_script(c, arg->rhs->str, (GAsyncReadyCallback)on_eval_script_finished);
+        ext_proxy_eval_script(c, arg->rhs->str, on_eval_script_finished, NULL);
     }
 
     return CMD_SUCCESS;
 }
 
-static void on_eval_script_finished(GDBusProxy *proxy, GAsyncResult *result, Client *c)
+static void on_eval_script_finished(Client *c, GVariant *result, gpointer data)
 {
     gboolean success = FALSE;
-    char *string = NULL;
+    const char *string = NULL;
 
-    GVariant *return_value = g_dbus_proxy_call_finish(proxy, result, NULL);
-    if (return_value) {
-        g_variant_get(return_value, "(bs)", &success, &string);
+    if (result) {
+        g_variant_get(result, "(b&s)", &success, &string);
         if (success) {
             vb_echo(c, MSG_NORMAL, FALSE, "%s", string);
         } else {
@@ -1195,7 +1386,7 @@ static gboolean complete(Client *c, short direction)
 
         /* Do ex command specific completion if the command is recognized and
          * there is a space after the command and the optional '!' bang. */
-        if (parse_command_name(c, &in, arg) && parse_bang(&in, arg) && VB_IS_SPACE(*in)) {
+        if (parse_command_name(c, &in, arg, FALSE) && parse_bang(&in, arg) && VB_IS_SPACE(*in)) {
             const char *token;
             /* Get only the last word of input string for the completion for
              * bookmark tag completion. */
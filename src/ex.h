@@ -29,6 +29,7 @@ VbResult ex_keypress(Client *c, int key);
 void ex_input_changed(Client *c, const char *text);
 gboolean ex_fill_completion(GtkListStore *store, const char *input);
 VbCmdResult ex_run_file(Client *c, const char *filename);
+void ex_cleanup(void);
 VbCmdResult ex_run_string(Client *c, const char *input, gboolean enable_history);
 
 #endif /* end of include guard: _EX_H */
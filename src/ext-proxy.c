@@ -17,13 +17,43 @@
  * along with this program. If not, see http://www.gnu.org/licenses/.
  */
 
+/* for memfd_create() */
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib.h>
+#include <glib-unix.h>
+#include <libsoup/soup.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #include "ext-proxy.h"
 #include "main.h"
 #include "webextension/ext-main.h"
 
+/* Time in milliseconds to wait for the web extension to answer a call. */
+#define CALL_TIMEOUT       5000
+/* Timeout for calls that the user has to wait for. */
+#define CALL_TIMEOUT_SHORT 500
+
+/* A call of a web extension method. */
+typedef struct {
+    Client           *c;
+    char             *method;
+    GVariant         *param;
+    gint64           deadline;  /* monotonic time the answer is expected */
+    guint            timer_id;  /* expires the call while it's queued */
+    GUnixFDList      *fds;      /* file descriptors to send or NULL */
+    ExtProxyCallback callback;
+    gpointer         data;
+} Call;
+
 static gboolean on_authorize_authenticated_peer(GDBusAuthObserver *observer,
         GIOStream *stream, GCredentials *credentials, gpointer data);
 static gboolean on_new_connection(GDBusServer *server,
@@ -36,10 +66,31 @@ static void on_vertical_scroll(GDBusConnection *connection,
         const char *sender_name, const char *object_path,
         const char *interface_name, const char *signal_name,
         GVariant *parameters, gpointer data);
+static void on_editable_focus(GDBusConnection *connection,
+        const char *sender_name, const char *object_path,
+        const char *interface_name, const char *signal_name,
+        GVariant *parameters, gpointer data);
+static void on_requests_blocked(GDBusConnection *connection,
+        const char *sender_name, const char *object_path,
+        const char *interface_name, const char *signal_name,
+        GVariant *parameters, gpointer data);
 static void dbus_call(Client *c, const char *method, GVariant *param,
-        GAsyncReadyCallback callback);
-static GVariant *dbus_call_sync(Client *c, const char *method, GVariant
-        *param);
+        int timeout, ExtProxyCallback callback, gpointer data);
+static void dbus_call_with_fds(Client *c, const char *method, GVariant *param,
+        GUnixFDList *fds, int timeout, ExtProxyCallback callback,
+        gpointer data);
+static void call_send(Call *call);
+static void call_free(Call *call);
+static void on_call_finished(GDBusProxy *proxy, GAsyncResult *result,
+        Call *call);
+static gboolean on_call_expired(Call *call);
+static void dbus_flush_calls(Client *c);
+static void signals_subscribe(Client *c);
+static void signals_unsubscribe(Client *c);
+static void shared_state_setup(Client *c);
+static gboolean on_shared_state_changed(int fd, GIOCondition condition,
+        Client *c);
+static void shared_state_free(Client *c);
 static void on_web_extension_page_created(GDBusConnection *connection,
         const char *sender_name, const char *object_path,
         const char *interface_name, const char *signal_name,
@@ -183,31 +234,122 @@ static void on_vertical_scroll(GDBusConnection *connection,
     glong max, top;
     guint percent;
     guint64 pageid;
-    Client *c;
+    Client *c = (Client*)data;
 
     g_variant_get(parameters, "(ttqt)", &pageid, &max, &percent, &top);
-    c = vb_get_client_for_page_id(pageid);
-    if (c) {
-        c->state.scroll_max     = max;
-        c->state.scroll_percent = percent;
-        c->state.scroll_top     = top;
+    c->state.scroll_max     = max;
+    c->state.scroll_percent = percent;
+    c->state.scroll_top     = top;
+
+    vb_statusbar_update(c);
+}
+
+/**
+ * Listen to the EditableFocus signal of the webextension to switch between
+ * normal and input mode if an editable element gets or loses the focus.
+ */
+static void on_editable_focus(GDBusConnection *connection,
+        const char *sender_name, const char *object_path,
+        const char *interface_name, const char *signal_name,
+        GVariant *parameters, gpointer data)
+{
+    gboolean is_focused;
+    Client *c = (Client*)data;
+
+    if (c->mode->flags & FLAG_IGNORE_FOCUS) {
+        return;
     }
 
+    g_variant_get(parameters, "(b)", &is_focused);
+
+    /* Don't change the mode if we are in pass through mode. */
+    if (c->mode->id == 'n' && is_focused) {
+        vb_enter(c, 'i');
+    } else if (c->mode->id == 'i' && !is_focused) {
+        vb_enter(c, 'n');
+    }
+}
+
+/**
+ * Listen to the RequestsBlocked signal of the webextension to show the
+ * number of blocked requests of the current page in the statusbar.
+ */
+static void on_requests_blocked(GDBusConnection *connection,
+        const char *sender_name, const char *object_path,
+        const char *interface_name, const char *signal_name,
+        GVariant *parameters, gpointer data)
+{
+    Client *c = (Client*)data;
+
+    g_variant_get(parameters, "(u)", &c->state.blocked_requests);
+
     vb_statusbar_update(c);
 }
 
-void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback)
+/**
+ * Cancel all pending calls and signal subscriptions of the client. The
+ * callbacks of the calls are not called anymore, so this can be used before
+ * the client is destroyed.
+ */
+void ext_proxy_cancel(Client *c)
+{
+    Call *call;
+
+    signals_unsubscribe(c);
+    shared_state_free(c);
+
+    if (c->dbuscancel) {
+        g_cancellable_cancel(c->dbuscancel);
+        g_object_unref(c->dbuscancel);
+        c->dbuscancel = NULL;
+    }
+    if (c->dbuscalls) {
+        while ((call = g_queue_pop_head(c->dbuscalls))) {
+            g_source_remove(call->timer_id);
+            call_free(call);
+        }
+        g_queue_free(c->dbuscalls);
+        c->dbuscalls = NULL;
+    }
+}
+
+/**
+ * Call one of the VB_JS_* functions of the web extension in the page. This is
+ * cheaper than ext_proxy_eval_script() because the function is compiled only
+ * once per document.
+ *
+ * @args:     Tuple with the arguments of the function or NULL.
+ * @callback: Called with the (bs) result of the function if given.
+ */
+void ext_proxy_call_js(Client *c, guint func, GVariant *args,
+        ExtProxyCallback callback, gpointer data)
 {
+    if (!args) {
+        args = g_variant_new("()");
+    }
     if (callback) {
-        dbus_call(c, "EvalJs", g_variant_new("(ts)", c->page_id, js), callback);
+        dbus_call(c, "CallJs", g_variant_new("(tuv)", c->page_id, func, args),
+                CALL_TIMEOUT, callback, data);
     } else {
-        dbus_call(c, "EvalJsNoResult", g_variant_new("(ts)", c->page_id, js), NULL);
+        dbus_call(c, "CallJsNoResult", g_variant_new("(tuv)", c->page_id, func, args),
+                CALL_TIMEOUT, NULL, NULL);
     }
 }
 
-GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
+/**
+ * Run the JavaScript in the page. If callback is given it is called with the
+ * (bs) result of the evaluation.
+ */
+void ext_proxy_eval_script(Client *c, char *js, ExtProxyCallback callback,
+        gpointer data)
 {
-    return dbus_call_sync(c, "EvalJs", g_variant_new("(ts)", c->page_id, js));
+    if (callback) {
+        dbus_call(c, "EvalJs", g_variant_new("(ts)", c->page_id, js),
+                CALL_TIMEOUT, callback, data);
+    } else {
+        dbus_call(c, "EvalJsNoResult", g_variant_new("(ts)", c->page_id, js),
+                CALL_TIMEOUT, NULL, NULL);
+    }
 }
 
 /**
@@ -216,62 +358,247 @@ GVariant *ext_proxy_eval_script_sync(Client *c, char *js)
  */
 void ext_proxy_focus_input(Client *c)
 {
-    dbus_call(c, "FocusInput", g_variant_new("(t)", c->page_id), NULL);
+    dbus_call(c, "FocusInput", g_variant_new("(t)", c->page_id), CALL_TIMEOUT, NULL, NULL);
 }
 
 /**
- * Send the headers string to the webextension.
+ * Send the header rules of the headers setting to the webextension. The
+ * setting is a list of [domain/]name[=[value]] items. The items are parsed
+ * here, so that the web extension only has to build the lookup table of the
+ * rules once.
  */
 void ext_proxy_set_header(Client *c, const char *headers)
 {
-    dbus_call(c, "SetHeaderSetting", g_variant_new("(s)", headers), NULL);
+    GVariantBuilder builder;
+    GHashTable *params;
+    GHashTableIter iter;
+    char *key, *value, *domain;
+    const char *name;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(ssbs)"));
+    params = soup_header_parse_param_list(headers);
+    g_hash_table_iter_init(&iter, params);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&key, (gpointer*)&value)) {
+        /* Header names can't contain '/' so the first one ends the domain. */
+        if ((name = strchr(key, '/'))) {
+            domain = g_strndup(key, name - key);
+            name++;
+        } else {
+            domain = g_strdup("");
+            name   = key;
+        }
+        /* Null value is used to indicate that the header should be removed
+         * completely. */
+        if (*name) {
+            g_variant_builder_add(&builder, "(ssbs)", domain, name,
+                    value == NULL, value ? value : "");
+        }
+        g_free(domain);
+    }
+    soup_header_free_param_list(params);
+
+    dbus_call(c, "SetHeaderRules", g_variant_new("(ta(ssbs))", c->page_id, &builder),
+            CALL_TIMEOUT, NULL, NULL);
 }
 
 void ext_proxy_lock_input(Client *c, const char *element_id)
 {
-    dbus_call(c, "LockInput", g_variant_new("(ts)", c->page_id, element_id), NULL);
+    dbus_call(c, "LockInput", g_variant_new("(ts)", c->page_id, element_id),
+            CALL_TIMEOUT, NULL, NULL);
 }
 
 void ext_proxy_unlock_input(Client *c, const char *element_id)
 {
-    dbus_call(c, "UnlockInput", g_variant_new("(ts)", c->page_id, element_id), NULL);
+    dbus_call(c, "UnlockInput", g_variant_new("(ts)", c->page_id, element_id),
+            CALL_TIMEOUT, NULL, NULL);
+}
+
+/**
+ * Start hinting in the web extension. The callback is called with the (bs)
+ * result of the hinting.
+ */
+void ext_proxy_hints_init(Client *c, char mode, gboolean keep_open,
+        guint max_hints, const char *keys, gboolean follow_last,
+        gboolean keys_same_length, ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsInit", g_variant_new("(tybusbb)", c->page_id, mode,
+                keep_open, max_hints, keys, follow_last, keys_same_length),
+            CALL_TIMEOUT, callback, NULL);
+}
+
+/**
+ * Filter the hints by text. The callback is called with the (bsu) result
+ * that contains the given sequence number seq.
+ */
+void ext_proxy_hints_filter(Client *c, const char *text, guint seq,
+        ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsFilter", g_variant_new("(tsu)", c->page_id, text, seq),
+            CALL_TIMEOUT, callback, NULL);
+}
+
+/**
+ * Add the hint key to the hint-keys filter or remove the last one if key is
+ * empty. The callback is called with the (bsu) result that contains the
+ * given sequence number seq.
+ */
+void ext_proxy_hints_update(Client *c, const char *key, guint seq,
+        ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsUpdate", g_variant_new("(tsu)", c->page_id, key, seq),
+            CALL_TIMEOUT, callback, NULL);
+}
+
+void ext_proxy_hints_focus(Client *c, gboolean back, ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsFocus", g_variant_new("(tb)", c->page_id, back),
+            CALL_TIMEOUT, callback, NULL);
+}
+
+void ext_proxy_hints_fire(Client *c, ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsFire", g_variant_new("(t)", c->page_id),
+            CALL_TIMEOUT, callback, NULL);
+}
+
+/**
+ * Remove the hints from the page. The callback is called after the hints
+ * were removed or the call failed.
+ */
+void ext_proxy_hints_clear(Client *c, ExtProxyCallback callback)
+{
+    dbus_call(c, "HintsClear", g_variant_new("(t)", c->page_id),
+            CALL_TIMEOUT_SHORT, callback, NULL);
 }
 
 /**
- * Call a dbus method.
+ * Call a dbus method. Calls made before the web extension created the page
+ * are queued and sent in order once the proxy is available.
+ *
+ * @timeout:  Milliseconds to wait for the answer including the time the
+ *            call is queued.
+ * @callback: Function called with the result or NULL if the call failed or
+ *            timed out. The result is freed after the callback returned.
  */
 static void dbus_call(Client *c, const char *method, GVariant *param,
-        GAsyncReadyCallback callback)
+        int timeout, ExtProxyCallback callback, gpointer data)
 {
-    /* TODO add function to queue calls until the proxy connection is
-     * established */
-    if (!c->dbusproxy) {
-        return;
-    }
-    g_dbus_proxy_call(c->dbusproxy, method, param, G_DBUS_CALL_FLAGS_NONE, -1, NULL, callback, c);
+    dbus_call_with_fds(c, method, param, NULL, timeout, callback, data);
 }
 
 /**
- * Call a dbus method syncron.
+ * Like dbus_call() but sends also the file descriptors of fds. The handles
+ * in param are the indices of the file descriptors in fds.
  */
-static GVariant *dbus_call_sync(Client *c, const char *method, GVariant *param)
+static void dbus_call_with_fds(Client *c, const char *method, GVariant *param,
+        GUnixFDList *fds, int timeout, ExtProxyCallback callback,
+        gpointer data)
 {
-    GVariant *result = NULL;
-    GError *error = NULL;
+    Call *call;
+
+    call           = g_slice_new0(Call);
+    call->c        = c;
+    call->method   = g_strdup(method);
+    call->param    = g_variant_ref_sink(param);
+    call->fds      = fds ? g_object_ref(fds) : NULL;
+    call->deadline = g_get_monotonic_time() + (gint64)timeout * 1000;
+    call->callback = callback;
+    call->data     = data;
+
+    if (c->dbusproxy) {
+        call_send(call);
+        return;
+    }
 
-    if (!c->dbusproxy) {
-        return NULL;
+    if (!c->dbuscalls) {
+        c->dbuscalls = g_queue_new();
     }
+    call->timer_id = g_timeout_add(timeout, (GSourceFunc)on_call_expired, call);
+    g_queue_push_tail(c->dbuscalls, call);
+}
 
-    result = g_dbus_proxy_call_sync(c->dbusproxy, method, param,
-        G_DBUS_CALL_FLAGS_NONE, 500, NULL, &error);
+static void call_send(Call *call)
+{
+    Client *c = call->c;
+    gint64 timeout;
 
-    if (error) {
-        g_warning("Failed dbus method %s: %s", method, error->message);
+    /* Use the time left for the call. */
+    timeout = MAX((call->deadline - g_get_monotonic_time()) / 1000, 1);
+    if (!c->dbuscancel) {
+        c->dbuscancel = g_cancellable_new();
+    }
+    g_dbus_proxy_call_with_unix_fd_list(c->dbusproxy, call->method,
+            call->param, G_DBUS_CALL_FLAGS_NONE, (int)timeout, call->fds,
+            c->dbuscancel, (GAsyncReadyCallback)on_call_finished, call);
+}
+
+static void call_free(Call *call)
+{
+    g_free(call->method);
+    g_variant_unref(call->param);
+    if (call->fds) {
+        g_object_unref(call->fds);
+    }
+    g_slice_free(Call, call);
+}
+
+static void on_call_finished(GDBusProxy *proxy, GAsyncResult *result,
+        Call *call)
+{
+    GVariant *value;
+    GError *error = NULL;
+
+    value = g_dbus_proxy_call_with_unix_fd_list_finish(proxy, NULL, result, &error);
+    if (!value) {
+        /* The call was cancelled because the client is destroyed. */
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_error_free(error);
+            call_free(call);
+            return;
+        }
+        g_warning("Failed dbus method %s: %s", call->method, error->message);
         g_error_free(error);
     }
 
-    return result;
+    if (call->callback) {
+        call->callback(call->c, value, call->data);
+    }
+    if (value) {
+        g_variant_unref(value);
+    }
+    call_free(call);
+}
+
+/**
+ * Called if the page wasn't created in time for a queued call.
+ */
+static gboolean on_call_expired(Call *call)
+{
+    g_queue_remove(call->c->dbuscalls, call);
+    g_warning("Failed dbus method %s: web extension not ready", call->method);
+    if (call->callback) {
+        call->callback(call->c, NULL, call->data);
+    }
+    call_free(call);
+
+    return FALSE;
+}
+
+/**
+ * Send the calls queued until the proxy for the client was available.
+ */
+static void dbus_flush_calls(Client *c)
+{
+    Call *call;
+
+    if (!c->dbuscalls) {
+        return;
+    }
+    while ((call = g_queue_pop_head(c->dbuscalls))) {
+        g_source_remove(call->timer_id);
+        call->timer_id = 0;
+        call_send(call);
+    }
 }
 
 /**
@@ -294,13 +621,161 @@ static void on_web_extension_page_created(GDBusConnection *connection,
      * webextension. */
     c = vb_get_client_for_page_id(pageid);
     if (c) {
+        /* The page might be created again, for example after the web
+         * process crashed, so drop the subscriptions of the old proxy. */
+        signals_unsubscribe(c);
+        shared_state_free(c);
         /* Set the dbus proxy on the right client based on page id. */
         c->dbusproxy = (GDBusProxy*)data;
+        dbus_flush_calls(c);
+        signals_subscribe(c);
+        shared_state_setup(c);
+    }
+}
+
+/**
+ * Subscribe to the signals of the client's page. The page signals are
+ * emitted on an object path of their own, so that D-Bus dispatches them
+ * directly to the subscription of the client.
+ */
+static void signals_subscribe(Client *c)
+{
+    GDBusConnection *connection;
+    char *path;
+
+    connection = g_dbus_proxy_get_connection(c->dbusproxy);
+    path = g_strdup_printf(VB_WEBEXTENSION_PAGE_PATH "%" G_GUINT64_FORMAT,
+            c->page_id);
+    c->dbusscroll = g_dbus_connection_signal_subscribe(connection, NULL,
+            VB_WEBEXTENSION_INTERFACE, "VerticalScroll", path, NULL,
+            G_DBUS_SIGNAL_FLAGS_NONE, (GDBusSignalCallback)on_vertical_scroll,
+            c, NULL);
+    c->dbusfocus = g_dbus_connection_signal_subscribe(connection, NULL,
+            VB_WEBEXTENSION_INTERFACE, "EditableFocus", path, NULL,
+            G_DBUS_SIGNAL_FLAGS_NONE, (GDBusSignalCallback)on_editable_focus,
+            c, NULL);
+    c->dbusblocked = g_dbus_connection_signal_subscribe(connection, NULL,
+            VB_WEBEXTENSION_INTERFACE, "RequestsBlocked", path, NULL,
+            G_DBUS_SIGNAL_FLAGS_NONE, (GDBusSignalCallback)on_requests_blocked,
+            c, NULL);
+    g_free(path);
+}
+
+static void signals_unsubscribe(Client *c)
+{
+    GDBusConnection *connection;
+
+    if (!c->dbusscroll) {
+        return;
+    }
+    connection = g_dbus_proxy_get_connection(c->dbusproxy);
+    g_dbus_connection_signal_unsubscribe(connection, c->dbusscroll);
+    g_dbus_connection_signal_unsubscribe(connection, c->dbusfocus);
+    g_dbus_connection_signal_unsubscribe(connection, c->dbusblocked);
+    c->dbusscroll  = 0;
+    c->dbusfocus   = 0;
+    c->dbusblocked = 0;
+}
+
+/**
+ * Create the memory region the web extension writes the scroll position of
+ * the page to and the eventfd it writes to after each change. So scrolling
+ * doesn't need a dbus message per update. If this isn't possible the web
+ * extension keeps sending the VerticalScroll signal.
+ */
+static void shared_state_setup(Client *c)
+{
+#ifdef __linux__
+    GUnixFDList *fds;
+    VbScrollState *state;
+    int fd, doorbell;
+
+    fd = memfd_create("vimb-scroll", MFD_CLOEXEC);
+    if (fd < 0) {
+        g_warning("Could not create scroll state: %s", g_strerror(errno));
+        return;
+    }
+    if (ftruncate(fd, sizeof(VbScrollState)) < 0
+        || (state = mmap(NULL, sizeof(VbScrollState), PROT_READ, MAP_SHARED,
+                fd, 0)) == MAP_FAILED) {
+        g_warning("Could not map scroll state: %s", g_strerror(errno));
+        close(fd);
+        return;
+    }
+    doorbell = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (doorbell < 0) {
+        g_warning("Could not create scroll doorbell: %s", g_strerror(errno));
+        munmap(state, sizeof(VbScrollState));
+        close(fd);
+        return;
+    }
 
-        /* Subscribe to dbus signals here. */
-        g_dbus_connection_signal_subscribe(connection, NULL,
-                VB_WEBEXTENSION_INTERFACE, "VerticalScroll",
-                VB_WEBEXTENSION_OBJECT_PATH, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
-                (GDBusSignalCallback)on_vertical_scroll, NULL, NULL);
+    /* The fd list holds duplicates of the file descriptors. */
+    fds = g_unix_fd_list_new();
+    g_unix_fd_list_append(fds, fd, NULL);
+    g_unix_fd_list_append(fds, doorbell, NULL);
+    close(fd);
+
+    c->shared.state    = state;
+    c->shared.doorbell = doorbell;
+    c->shared.watch    = g_unix_fd_add(doorbell, G_IO_IN,
+            (GUnixFDSourceFunc)on_shared_state_changed, c);
+
+    dbus_call_with_fds(c, "SetScrollState",
+            g_variant_new("(thh)", c->page_id, 0, 1), fds, CALL_TIMEOUT,
+            NULL, NULL);
+    g_object_unref(fds);
+#endif
+}
+
+/**
+ * Called when the web extension changed the shared scroll position.
+ */
+static gboolean on_shared_state_changed(int fd, GIOCondition condition,
+        Client *c)
+{
+    VbScrollState *state = c->shared.state;
+    guint64 count;
+    gint64 max, top;
+    guint percent;
+    int seq, i;
+
+    /* Reset the eventfd so that it's readable again on the next change. */
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        g_warning("Could not read scroll doorbell: %s", g_strerror(errno));
+    }
+
+    /* Retry if the web extension wrote during the read. Give up after some
+     * attempts in case the web process died in the middle of a write. */
+    for (i = 0; i < 100; i++) {
+        seq = g_atomic_int_get(&state->seq);
+        if (seq & 1) {
+            continue;
+        }
+        max     = state->max;
+        percent = state->percent;
+        top     = state->top;
+        /* Don't let the reads of the values be moved after the check. */
+        __sync_synchronize();
+        if (g_atomic_int_get(&state->seq) == seq) {
+            c->state.scroll_max     = max;
+            c->state.scroll_percent = percent;
+            c->state.scroll_top     = top;
+            vb_statusbar_update(c);
+            break;
+        }
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void shared_state_free(Client *c)
+{
+    if (c->shared.state) {
+        g_source_remove(c->shared.watch);
+        close(c->shared.doorbell);
+        munmap(c->shared.state, sizeof(VbScrollState));
+        c->shared.state = NULL;
+        c->shared.watch = 0;
     }
 }
@@ -22,12 +22,29 @@
 
 #include "main.h"
 
+/* Called with the result of a web extension call or NULL if the call failed
+ * or timed out. The result is freed after the callback returned. */
+typedef void (*ExtProxyCallback)(Client *c, GVariant *result, gpointer data);
+
 const char *ext_proxy_init(void);
-void ext_proxy_eval_script(Client *c, char *js, GAsyncReadyCallback callback);
-GVariant *ext_proxy_eval_script_sync(Client *c, char *js);
+void ext_proxy_cancel(Client *c);
+void ext_proxy_eval_script(Client *c, char *js, ExtProxyCallback callback,
+        gpointer data);
+void ext_proxy_call_js(Client *c, guint func, GVariant *args,
+        ExtProxyCallback callback, gpointer data);
 void ext_proxy_focus_input(Client *c);
 void ext_proxy_set_header(Client *c, const char *headers);
 void ext_proxy_lock_input(Client *c, const char *element_id);
 void ext_proxy_unlock_input(Client *c, const char *element_id);
+void ext_proxy_hints_init(Client *c, char mode, gboolean keep_open,
+        guint max_hints, const char *keys, gboolean follow_last,
+        gboolean keys_same_length, ExtProxyCallback callback);
+void ext_proxy_hints_filter(Client *c, const char *text, guint seq,
+        ExtProxyCallback callback);
+void ext_proxy_hints_update(Client *c, const char *key, guint seq,
+        ExtProxyCallback callback);
+void ext_proxy_hints_focus(Client *c, gboolean back, ExtProxyCallback callback);
+void ext_proxy_hints_fire(Client *c, ExtProxyCallback callback);
+void ext_proxy_hints_clear(Client *c, ExtProxyCallback callback);
 
 #endif /* end of include guard: _EXT_PROXY_H */
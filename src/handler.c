@@ -27,6 +27,7 @@ extern struct Vimb vb;
 
 struct handler {
     GHashTable *table;  /* holds the protocol handlers */
+    int        maxlen;  /* length of the longest scheme ever added */
 };
 
 static char *handler_lookup(Handler *h, const char *uri);
@@ -35,10 +36,29 @@ Handler *handler_new(void)
 {
     Handler *h = g_new(Handler, 1);
     h->table   = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    h->maxlen  = 0;
 
     return h;
 }
 
+/**
+ * Creates a new handler table with the handlers of given one.
+ */
+Handler *handler_copy(Handler *h)
+{
+    GHashTableIter iter;
+    char *key, *cmd;
+    Handler *copy = handler_new();
+
+    g_hash_table_iter_init(&iter, h->table);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&key, (gpointer*)&cmd)) {
+        g_hash_table_insert(copy->table, g_strdup(key), g_strdup(cmd));
+    }
+    copy->maxlen = h->maxlen;
+
+    return copy;
+}
+
 void handler_free(Handler *h)
 {
     if (h->table) {
@@ -50,7 +70,12 @@ void handler_free(Handler *h)
 
 gboolean handler_add(Handler *h, const char *key, const char *cmd)
 {
+    int len = strlen(key);
+
     g_hash_table_insert(h->table, g_strdup(key), g_strdup(cmd));
+    if (len > h->maxlen) {
+        h->maxlen = len;
+    }
 
     return TRUE;
 }
@@ -92,15 +117,37 @@ gboolean handler_fill_completion(Handler *h, GtkListStore *store, const char *in
     return found;
 }
 
+/**
+ * Retrieves the handler command for the scheme of given uri. This is called
+ * for each navigation, so the scheme is copied to the stack instead of the
+ * heap for the lookup.
+ */
 static char *handler_lookup(Handler *h, const char *uri)
 {
-    char *p, *schema, *handler = NULL;
+    char scheme[32], *schema, *handler;
+    int len;
+
+    /* without handlers there is nothing to look up */
+    if (!g_hash_table_size(h->table)) {
+        return NULL;
+    }
 
-    if ((p = strchr(uri, ':'))) {
-        schema  = g_strndup(uri, p - uri);
-        handler = g_hash_table_lookup(h->table, schema);
-        g_free(schema);
+    /* schemes longer than the longest handler can't have a handler */
+    for (len = 0; len <= h->maxlen && uri[len] && uri[len] != ':'; len++);
+    if (len > h->maxlen || uri[len] != ':') {
+        return NULL;
     }
 
+    if (len < (int)sizeof(scheme)) {
+        memcpy(scheme, uri, len);
+        scheme[len] = '\0';
+
+        return g_hash_table_lookup(h->table, scheme);
+    }
+
+    schema  = g_strndup(uri, len);
+    handler = g_hash_table_lookup(h->table, schema);
+    g_free(schema);
+
     return handler;
 }
@@ -23,6 +23,7 @@
 typedef struct handler Handler;
 
 Handler *handler_new();
+Handler *handler_copy(Handler *h);
 void handler_free(Handler *h);
 gboolean handler_add(Handler *h, const char *key, const char *cmd);
 gboolean handler_remove(Handler *h, const char *key);
@@ -30,39 +30,46 @@
 #include "input.h"
 #include "map.h"
 #include "normal.h"
+#include "setting.h"
 #include "ext-proxy.h"
 
 static struct {
     char           mode;      /* mode identifying char - that last char of the hint prompt */
     int            promptlen; /* length of the hint prompt chars 2 or 3 */
     gboolean       gmode;     /* indicate if the hints 'g' mode is used */
-    /* holds the setting if JavaScript can open windows automatically that we
-     * have to change to open windows via hinting */
-    gboolean       allow_open_win;
-    gboolean       allow_javascript;
     guint          timeout_id;
+    guint          seq;       /* sequence number of the last filter request */
+    guint          keycount;  /* number of hint keys sent to filter the hints */
+    HintsResultFunc result_func;
 } hints;
 
 extern struct Vimb vb;
 
-static gboolean call_hints_function(Client *c, const char *func, const char* args,
-        gboolean sync);
-static void on_hint_function_finished(GDBusProxy *proxy, GAsyncResult *result,
-        Client *c);
-static gboolean hint_function_check_result(Client *c, GVariant *return_value);
+static void update(Client *c, const char *key);
+static void on_hints_cleared(Client *c, GVariant *result, gpointer data);
+static void on_hint_function_finished(Client *c, GVariant *result, gpointer data);
+static void on_hint_filter_finished(Client *c, GVariant *result, gpointer data);
+static void hint_function_check_result(Client *c, gboolean success,
+        char *value);
 static void fire_timeout(Client *c, gboolean on);
 static gboolean fire_cb(gpointer data);
 
 
 VbResult hints_keypress(Client *c, int key)
 {
+    const char *keys;
+
     if (key == KEY_CR) {
         hints_fire(c);
 
         return RESULT_COMPLETE;
     } else if (key == CTRL('H')) { /* backspace */
         fire_timeout(c, FALSE);
-        if (call_hints_function(c, "update", "null", TRUE)) {
+        /* Remove the last hint key if there is one, else the backspace is
+         * applied to the filter text in the inputbox. */
+        if (hints.keycount) {
+            hints.keycount--;
+            update(c, "");
             return RESULT_COMPLETE;
         }
     } else if (key == KEY_TAB) {
@@ -80,9 +87,19 @@ VbResult hints_keypress(Client *c, int key)
     } else if (key == CTRL('J') || key == CTRL('K')) {
         return normal_keypress(c, UNCTRL(key));
     } else {
-        fire_timeout(c, TRUE);
-        /* try to handle the key by the javascript */
-        if (call_hints_function(c, "update", (char[]){'"', key, '"', '\0'}, TRUE)) {
+        /* The web extension falls back to numeric hints for empty hint-keys
+         * too. */
+        keys = GET_CHAR(c, "hint-keys");
+        if (!keys || !*keys) {
+            keys = "0123456789";
+        }
+        /* Handle the key as hint-key without waiting for the result, so that
+         * a slow page doesn't block typing. Other keys are used to filter
+         * the hints by their text. */
+        if (key > 0 && key < CSI && strchr(keys, key)) {
+            fire_timeout(c, TRUE);
+            hints.keycount++;
+            update(c, (char[]){key, '\0'});
             return RESULT_COMPLETE;
         }
     }
@@ -97,25 +114,15 @@ void hints_clear(Client *c)
         c->mode->flags &= ~FLAG_HINTING;
         vb_input_set_text(c, "");
 
-        /* Run this sync else we would disable JavaScript before the hint is
-         * fired. */
-        call_hints_function(c, "clear", "true", TRUE);
-
-        /* if open window was not allowed for JavaScript, restore this */
-        WebKitSettings *setting = webkit_web_view_get_settings(c->webview);
-        if (!hints.allow_open_win) {
-            g_object_set(G_OBJECT(setting), "javascript-can-open-windows-automatically", hints.allow_open_win, NULL);
-        }
-        if (!hints.allow_javascript) {
-            g_object_set(G_OBJECT(setting), "enable-javascript", hints.allow_javascript, NULL);
-        }
+        /* Restore the settings not before the hints are removed, else we
+         * would disable JavaScript before the hint is fired. */
+        c->hints.restore = TRUE;
+        ext_proxy_hints_clear(c, on_hints_cleared);
     }
 }
 
 void hints_create(Client *c, const char *input)
 {
-    char *jsargs;
-
     /* check if the input contains a valid hinting prompt */
     if (!hints_parse_prompt(input, &hints.mode, &hints.gmode)) {
         /* if input is not valid, clear possible previous hint mode */
@@ -131,56 +138,56 @@ void hints_create(Client *c, const char *input)
         WebKitSettings *setting = webkit_web_view_get_settings(c->webview);
 
         /* before we enable JavaScript to open new windows, we save the actual
-         * value to be able restore it after hints where fired */
-        g_object_get(G_OBJECT(setting),
-                "javascript-can-open-windows-automatically", &(hints.allow_open_win),
-                "enable-javascript", &(hints.allow_javascript),
-                NULL);
+         * value to be able restore it after hints where fired - if the
+         * previous hinting has not restored them yet, the saved values are
+         * kept */
+        if (!c->hints.restore) {
+            g_object_get(G_OBJECT(setting),
+                    "javascript-can-open-windows-automatically", &(c->hints.allow_open_win),
+                    "enable-javascript", &(c->hints.allow_javascript),
+                    NULL);
+        }
 
         /* if window open is already allowed there's no need to allow it again */
-        if (!hints.allow_open_win) {
+        if (!c->hints.allow_open_win) {
             g_object_set(G_OBJECT(setting), "javascript-can-open-windows-automatically", TRUE, NULL);
         }
         /* TODO This might be a security issue to toggle JavaScript
          * temporarily on. */
-        /* This is a hack to allow window.setTimeout() and scroll observers in
-         * hinting script which does not work when JavaScript is disabled. */
-        if (!hints.allow_javascript) {
+        /* This is a hack to allow the click handlers of the hinted elements
+         * and opening the hinted links which does not work when JavaScript
+         * is disabled. */
+        if (!c->hints.allow_javascript) {
             g_object_set(G_OBJECT(setting), "enable-javascript", TRUE, NULL);
         }
 
         hints.promptlen = hints.gmode ? 3 : 2;
+        hints.keycount  = 0;
 
-        jsargs = g_strdup_printf("'%s', %s, %d, '%s', %s, %s",
-            (char[]){hints.mode, '\0'},
-            hints.gmode ? "true" : "false",
-            MAXIMUM_HINTS,
-            GET_CHAR(c, "hint-keys"),
-            GET_BOOL(c, "hint-follow-last") ? "true" : "false",
-            GET_BOOL(c, "hint-keys-same-length") ? "true" : "false"
-        );
-
-        call_hints_function(c, "init", jsargs, FALSE);
-        g_free(jsargs);
+        ext_proxy_hints_init(c, hints.mode, hints.gmode, MAXIMUM_HINTS,
+                GET_CHAR(c, "hint-keys"), GET_BOOL(c, "hint-follow-last"),
+                GET_BOOL(c, "hint-keys-same-length"),
+                on_hint_function_finished);
 
         /* if hinting is started there won't be any additional filter given and
          * we can go out of this function */
         return;
     }
 
-    jsargs = g_strdup_printf("'%s'", *(input + hints.promptlen) ? input + hints.promptlen : "");
-    call_hints_function(c, "filter", jsargs, FALSE);
-    g_free(jsargs);
+    /* The web extension drops the hint keys if the filter text changes. */
+    hints.keycount = 0;
+    ext_proxy_hints_filter(c, input + hints.promptlen, ++hints.seq,
+            on_hint_filter_finished);
 }
 
 void hints_focus_next(Client *c, const gboolean back)
 {
-    call_hints_function(c, "focus", back ? "true" : "false", FALSE);
+    ext_proxy_hints_focus(c, back, on_hint_function_finished);
 }
 
 void hints_fire(Client *c)
 {
-    call_hints_function(c, "fire", "", FALSE);
+    ext_proxy_hints_fire(c, on_hint_function_finished);
 }
 
 void hints_follow_link(Client *c, const gboolean back, int count)
@@ -205,13 +212,19 @@ void hints_follow_link(Client *c, const gboolean back, int count)
     /* call_hints_function(c, "followLink", 3, arguments);         */
 }
 
-void hints_increment_uri(Client *c, int count)
+/**
+ * Set a function that is called after each handled result of the web
+ * extension. This is used to measure the hinting.
+ */
+void hints_set_result_func(HintsResultFunc func)
 {
-    char *jsargs;
+    hints.result_func = func;
+}
 
-    jsargs = g_strdup_printf("%d", count);
-    call_hints_function(c, "incrementUri", jsargs, FALSE);
-    g_free(jsargs);
+void hints_increment_uri(Client *c, int count)
+{
+    ext_proxy_call_js(c, VB_JS_INCREMENT_URI, g_variant_new("(i)", count),
+            NULL, NULL);
 }
 
 /**
@@ -273,46 +286,74 @@ gboolean hints_parse_prompt(const char *prompt, char *mode, gboolean *is_gmode)
     return res;
 }
 
-static gboolean call_hints_function(Client *c, const char *func, const char* args,
-        gboolean sync)
+/**
+ * Send the hint key to the web extension. Each request gets a new sequence
+ * number to identify outdated results.
+ */
+static void update(Client *c, const char *key)
 {
-    char *jscode;
-    /* Default value is only return in case of async call. */
-    gboolean success = TRUE;
-
-    jscode = g_strdup_printf("hints.%s(%s);", func, args);
-    if (sync) {
-        GVariant *result;
-        result  = ext_proxy_eval_script_sync(c, jscode);
-        success = hint_function_check_result(c, result);
-    } else {
-        ext_proxy_eval_script(c, jscode, (GAsyncReadyCallback)on_hint_function_finished);
+    ext_proxy_hints_update(c, key, ++hints.seq, on_hint_filter_finished);
+}
+
+/**
+ * Restore the settings changed for hinting once the hints are removed.
+ */
+static void on_hints_cleared(Client *c, GVariant *result, gpointer data)
+{
+    WebKitSettings *setting;
+
+    c->hints.restore = FALSE;
+    /* keep the settings if hinting was started again in the meantime */
+    if (c->mode->flags & FLAG_HINTING) {
+        return;
     }
-    g_free(jscode);
 
-    return success;
+    /* if open window was not allowed for JavaScript, restore this */
+    setting = webkit_web_view_get_settings(c->webview);
+    if (!c->hints.allow_open_win) {
+        g_object_set(G_OBJECT(setting), "javascript-can-open-windows-automatically", c->hints.allow_open_win, NULL);
+    }
+    if (!c->hints.allow_javascript) {
+        g_object_set(G_OBJECT(setting), "enable-javascript", c->hints.allow_javascript, NULL);
+    }
 }
 
-static void on_hint_function_finished(GDBusProxy *proxy, GAsyncResult *result,
-        Client *c)
+static void on_hint_function_finished(Client *c, GVariant *result, gpointer data)
 {
-    GVariant *return_value;
+    gboolean success = FALSE;
+    char *value = NULL;
 
-    return_value = g_dbus_proxy_call_finish(proxy, result, NULL);
-    hint_function_check_result(c, return_value);
+    if (result) {
+        g_variant_get(result, "(b&s)", &success, &value);
+    }
+    hint_function_check_result(c, success, value);
 }
 
-static gboolean hint_function_check_result(Client *c, GVariant *return_value)
+/**
+ * Handle the result of a filter or hint key request. Results of requests
+ * that are already followed by another one are skipped unless they report
+ * a fired hint.
+ */
+static void on_hint_filter_finished(Client *c, GVariant *result, gpointer data)
 {
     gboolean success = FALSE;
     char *value = NULL;
+    guint seq = 0;
 
-    if (!return_value) {
-        goto error;
+    if (result) {
+        g_variant_get(result, "(b&su)", &success, &value, &seq);
+    }
+    if (!result || seq == hints.seq || (success
+            && (!strncmp(value, "DONE:", 5) || !strncmp(value, "INSERT:", 7)
+                || !strncmp(value, "DATA:", 5)))) {
+        hint_function_check_result(c, success, value);
     }
+}
 
-    g_variant_get(return_value, "(bs)", &success, &value);
-    if (!success || !strncmp(value, "ERROR:", 6)) {
+static void hint_function_check_result(Client *c, gboolean success,
+        char *value)
+{
+    if (!success || !value || !strncmp(value, "ERROR:", 6)) {
         goto error;
     }
     if (!strncmp(value, "OVER:", 5)) {
@@ -407,12 +448,17 @@ static gboolean hint_function_check_result(Client *c, GVariant *return_value)
 #endif
         }
     }
+    if (hints.result_func) {
+        hints.result_func(c, value);
+    }
 
-    return TRUE;
+    return;
 
 error:
     vb_statusbar_show_hover_url(c, LINK_TYPE_NONE, NULL);
-    return FALSE;
+    if (hints.result_func) {
+        hints.result_func(c, "ERROR:");
+    }
 }
 
 static void fire_timeout(Client *c, gboolean on)
@@ -22,6 +22,8 @@
 
 #include "main.h"
 
+typedef void (*HintsResultFunc)(Client *c, const char *result);
+
 VbResult hints_keypress(Client *c, int key);
 void hints_create(Client *c, const char *input);
 void hints_fire(Client *c);
@@ -30,5 +32,6 @@ void hints_increment_uri(Client *c, int count);
 gboolean hints_parse_prompt(const char *prompt, char *mode, gboolean *is_gmode);
 void hints_clear(Client *c);
 void hints_focus_next(Client *c, const gboolean back);
+void hints_set_result_func(HintsResultFunc func);
 
 #endif /* end of include guard: _HINTS_H */
@@ -27,8 +27,6 @@
 #include "input.h"
 #include "main.h"
 #include "normal.h"
-#include "util.h"
-#include "scripts/scripts.h"
 #include "ext-proxy.h"
 
 typedef struct {
@@ -36,6 +34,8 @@ typedef struct {
     unsigned long element_map_key;
 } ElementEditorData;
 
+static void on_editor_value(Client *c, GVariant *result, gpointer data);
+static void on_editor_id(Client *c, GVariant *result, gpointer data);
 static void input_editor_formfiller(const char *text, Client *c, gpointer data);
 
 /**
@@ -47,7 +47,7 @@ void input_enter(Client *c)
      * disturbing the user */
     gtk_widget_grab_focus(GTK_WIDGET(c->webview));
     vb_modelabel_update(c, "-- INPUT --");
-    ext_proxy_eval_script(c, "var vimb_input_mode_element = document.activeElement;", NULL);
+    ext_proxy_call_js(c, VB_JS_INPUT_ENTER, NULL, NULL, NULL);
 }
 
 /**
@@ -55,7 +55,7 @@ void input_enter(Client *c)
  */
 void input_leave(Client *c)
 {
-    ext_proxy_eval_script(c, "vimb_input_mode_element.blur();", NULL);
+    ext_proxy_call_js(c, VB_JS_INPUT_LEAVE, NULL, NULL, NULL);
     vb_modelabel_update(c, "");
 }
 
@@ -109,82 +109,93 @@ VbResult input_keypress(Client *c, int key)
 
 VbResult input_open_editor(Client *c)
 {
-    static unsigned long element_map_key = 0;
-    char *element_id = NULL;
-    char *text = NULL, *id = NULL;
-    gboolean success;
-    GVariant *jsreturn;
-    GVariant *idreturn;
-    ElementEditorData *data = NULL;
-
     g_assert(c);
 
-    /* get the selected input element */
-    jsreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.value");
-    g_variant_get(jsreturn, "(bs)", &success, &text);
+    /* get the selected input element, the editor is opened once the web
+     * extension returned the value */
+    ext_proxy_call_js(c, VB_JS_INPUT_VALUE, NULL, on_editor_value, NULL);
+
+    return RESULT_COMPLETE;
+}
+
+/**
+ * Called with the value of the selected input element to query its id.
+ */
+static void on_editor_value(Client *c, GVariant *result, gpointer data)
+{
+    gboolean success = FALSE;
+    char *text = NULL;
 
+    if (result) {
+        g_variant_get(result, "(bs)", &success, &text);
+    }
     if (!success || !text) {
-        return RESULT_ERROR;
+        g_free(text);
+        return;
     }
 
-    idreturn = ext_proxy_eval_script_sync(c, "vimb_input_mode_element.id");
-    g_variant_get(idreturn, "(bs)", &success, &id);
+    ext_proxy_call_js(c, VB_JS_INPUT_ID, NULL, on_editor_id, text);
+}
+
+/**
+ * Called with the id of the selected input element to finally spawn the
+ * editor with the text of the element given as data.
+ */
+static void on_editor_id(Client *c, GVariant *result, gpointer data)
+{
+    static unsigned long element_map_key = 0;
+    char *element_id = NULL, *text = data;
+    const char *id = NULL;
+    gboolean success = FALSE;
+    ElementEditorData *eed;
+
+    if (result) {
+        g_variant_get(result, "(b&s)", &success, &id);
+    }
 
     /* Special case: the input element does not have an id assigned to it */
     if (!success || !*id) {
-        char *js_command = g_strdup_printf(JS_SET_EDITOR_MAP_ELEMENT, ++element_map_key);
-        ext_proxy_eval_script(c, js_command, NULL);
-        g_free(js_command);
+        ext_proxy_call_js(c, VB_JS_EDITOR_MAP_SET,
+                g_variant_new("(t)", (guint64)++element_map_key), NULL, NULL);
     } else {
         element_id = g_strdup(id);
     }
 
-    data                    = g_slice_new0(ElementEditorData);
-    data->element_id        = element_id;
-    data->element_map_key   = element_map_key;
+    eed                  = g_slice_new0(ElementEditorData);
+    eed->element_id      = element_id;
+    eed->element_map_key = element_map_key;
 
-    if (command_spawn_editor(c, &((Arg){0, text}), input_editor_formfiller, data)) {
+    if (command_spawn_editor(c, &((Arg){0, text}), input_editor_formfiller, eed)) {
         /* disable the active element */
         ext_proxy_lock_input(c, element_id);
-
-        return RESULT_COMPLETE;
+    } else {
+        g_free(element_id);
+        g_slice_free(ElementEditorData, eed);
     }
-
-    g_free(element_id);
-    g_slice_free(ElementEditorData, data);
-    return RESULT_ERROR;
+    g_free(text);
 }
 
 static void input_editor_formfiller(const char *text, Client *c, gpointer data)
 {
-    char *escaped;
-    char *jscode;
-    char *jscode_enable;
     ElementEditorData *eed = (ElementEditorData *)data;
 
     if (text) {
-        escaped = util_strescape(text, NULL);
-
         /* put the text back into the element */
         if (eed->element_id && strlen(eed->element_id) > 0) {
-            jscode = g_strdup_printf("document.getElementById(\"%s\").value=\"%s\"", eed->element_id, escaped);
+            ext_proxy_call_js(c, VB_JS_EDITOR_SET_BY_ID,
+                    g_variant_new("(ss)", eed->element_id, text), NULL, NULL);
         } else {
-            jscode = g_strdup_printf("vimb_editor_map.get(\"%lu\").value=\"%s\"", eed->element_map_key, escaped);
+            ext_proxy_call_js(c, VB_JS_EDITOR_SET_BY_KEY,
+                    g_variant_new("(ts)", (guint64)eed->element_map_key, text),
+                    NULL, NULL);
         }
-
-        ext_proxy_eval_script(c, jscode, NULL);
-
-        g_free(jscode);
-        g_free(escaped);
     }
 
     if (eed->element_id && strlen(eed->element_id) > 0) {
         ext_proxy_unlock_input(c, eed->element_id);
     } else {
-        jscode_enable = g_strdup_printf(JS_FOCUS_EDITOR_MAP_ELEMENT,
-                eed->element_map_key, eed->element_map_key);
-        ext_proxy_eval_script(c, jscode_enable, NULL);
-        g_free(jscode_enable);
+        ext_proxy_call_js(c, VB_JS_EDITOR_MAP_FOCUS,
+                g_variant_new("(t)", (guint64)eed->element_map_key), NULL, NULL);
     }
 
     g_free(eed->element_id);
@@ -0,0 +1,219 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <string.h>
+
+#include "keyword-set.h"
+
+/*
+ * The keyword set finds all the keywords contained in a subject with a
+ * single pass over the subject. The keywords are put into a trie that is
+ * turned into an Aho-Corasick automaton. Keywords are matched case
+ * insensitive. The set has no dependencies beside GLib, so that it can be
+ * used by the web extension too.
+ */
+
+/* Node of the Aho-Corasick automaton. */
+typedef struct {
+    char   c;
+    int    child;   /* first child node */
+    int    next;    /* next sibling node */
+    int    fail;    /* node of the longest proper suffix in the trie */
+    int    dict;    /* next node on the fail chain that has data */
+    GSList *data;   /* data of the keywords ending in this node */
+} Node;
+
+struct keywordset {
+    Node     *nodes;
+    int      len;
+    int      size;
+    int      root[256];     /* children of the root node by char */
+    gboolean dirty;         /* the fail links must be rebuilt */
+};
+
+static int get_child(KeywordSet *set, int node, char c);
+static int add_child(KeywordSet *set, int node, char c);
+
+
+KeywordSet *keyword_set_new(void)
+{
+    KeywordSet *set = g_slice_new0(KeywordSet);
+
+    keyword_set_clear(set);
+
+    return set;
+}
+
+void keyword_set_free(KeywordSet *set)
+{
+    keyword_set_clear(set);
+    g_free(set->nodes);
+    g_slice_free(KeywordSet, set);
+}
+
+/**
+ * Adds the first len chars of keyword to the set. The data is given to the
+ * callback of keyword_set_search() each time the keyword is found.
+ */
+void keyword_set_add(KeywordSet *set, const char *keyword, gsize len,
+        gpointer data)
+{
+    int node, child;
+    gsize i;
+
+    for (node = 0, i = 0; i < len; i++) {
+        if (!(child = get_child(set, node, keyword[i]))) {
+            child = add_child(set, node, keyword[i]);
+        }
+        node = child;
+    }
+    set->nodes[node].data = g_slist_prepend(set->nodes[node].data, data);
+    set->dirty = TRUE;
+}
+
+/**
+ * Removes all the keywords from the set.
+ */
+void keyword_set_clear(KeywordSet *set)
+{
+    int i;
+
+    for (i = 0; i < set->len; i++) {
+        g_slist_free(set->nodes[i].data);
+    }
+    memset(set->root, 0, sizeof(set->root));
+    set->len   = 0;
+    set->dirty = FALSE;
+    add_child(set, -1, '\0');
+}
+
+/**
+ * Sets the fail links of the automaton in breadth first order. This is done
+ * by keyword_set_search() if keywords were added, but can be called before
+ * to move the work out of the first search.
+ */
+void keyword_set_compile(KeywordSet *set)
+{
+    int node, child, fail, head, tail, *queue;
+
+    queue = g_new(int, set->len);
+    head  = tail = 0;
+    for (child = set->nodes[0].child; child; child = set->nodes[child].next) {
+        set->nodes[child].fail = set->nodes[child].dict = 0;
+        queue[tail++] = child;
+    }
+    while (head < tail) {
+        node = queue[head++];
+        for (child = set->nodes[node].child; child; child = set->nodes[child].next) {
+            fail = set->nodes[node].fail;
+            while (fail && !get_child(set, fail, set->nodes[child].c)) {
+                fail = set->nodes[fail].fail;
+            }
+            fail                   = get_child(set, fail, set->nodes[child].c);
+            set->nodes[child].fail = fail;
+            set->nodes[child].dict = set->nodes[fail].data ? fail : set->nodes[fail].dict;
+
+            queue[tail++] = child;
+        }
+    }
+    g_free(queue);
+
+    set->dirty = FALSE;
+}
+
+/**
+ * Calls func with the data of each keyword found in the first len chars of
+ * subject, or up to the terminating nul if len is -1. Returns TRUE if the
+ * search was stopped by func.
+ */
+gboolean keyword_set_search(KeywordSet *set, const char *subject, gsize len,
+        KeywordSetFunc func, gpointer user_data)
+{
+    const char *s, *end;
+    int node, next = 0, n;
+    GSList *l;
+
+    if (set->dirty) {
+        keyword_set_compile(set);
+    }
+    /* Nothing can be found without keywords. */
+    if (set->len == 1) {
+        return FALSE;
+    }
+
+    end = len == (gsize)-1 ? NULL : subject + len;
+    for (node = 0, s = subject; end ? s < end : *s != '\0'; s++) {
+        while (node && !(next = get_child(set, node, *s))) {
+            node = set->nodes[node].fail;
+        }
+        node = node ? next : get_child(set, 0, *s);
+        for (n = set->nodes[node].data ? node : set->nodes[node].dict; n; n = set->nodes[n].dict) {
+            for (l = set->nodes[n].data; l; l = l->next) {
+                if (func(l->data, s - subject + 1, user_data)) {
+                    return TRUE;
+                }
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+static int get_child(KeywordSet *set, int node, char c)
+{
+    int child;
+
+    c = g_ascii_tolower(c);
+    if (!node) {
+        return set->root[(unsigned char)c];
+    }
+    for (child = set->nodes[node].child; child; child = set->nodes[child].next) {
+        if (set->nodes[child].c == c) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Appends a new node for char c to the children of given node and returns
+ * the index of the new node.
+ */
+static int add_child(KeywordSet *set, int node, char c)
+{
+    Node *new;
+
+    if (set->len == set->size) {
+        set->size  = set->size ? set->size * 2 : 64;
+        set->nodes = g_renew(Node, set->nodes, set->size);
+    }
+    c   = g_ascii_tolower(c);
+    new = &set->nodes[set->len];
+    memset(new, 0, sizeof(Node));
+    new->c = c;
+    if (node >= 0) {
+        new->next              = set->nodes[node].child;
+        set->nodes[node].child = set->len;
+    }
+    if (node == 0) {
+        set->root[(unsigned char)c] = set->len;
+    }
+
+    return set->len++;
+}
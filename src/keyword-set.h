@@ -0,0 +1,39 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _KEYWORD_SET_H
+#define _KEYWORD_SET_H
+
+#include <glib.h>
+
+typedef struct keywordset KeywordSet;
+/* Called for each keyword found with the offset of the subject just behind
+ * the keyword, returns TRUE to stop the search. */
+typedef gboolean (*KeywordSetFunc)(gpointer data, gsize end, gpointer user_data);
+
+KeywordSet *keyword_set_new(void);
+void keyword_set_free(KeywordSet *set);
+void keyword_set_add(KeywordSet *set, const char *keyword, gsize len,
+        gpointer data);
+void keyword_set_clear(KeywordSet *set);
+void keyword_set_compile(KeywordSet *set);
+gboolean keyword_set_search(KeywordSet *set, const char *subject, gsize len,
+        KeywordSetFunc func, gpointer user_data);
+
+#endif /* end of include guard: _KEYWORD_SET_H */
@@ -106,6 +106,10 @@ static void update_urlbar(Client *c);
 static void set_statusbar_style(Client *c, StatusType type);
 static void set_title(Client *c, const char *title);
 static void spawn_new_instance(const char *uri);
+static gint64 startup_phase_begin(void);
+static void startup_phase_end(const char *name, gint64 start);
+static void startup_mark(const char *name);
+static void startup_profile_write(void);
 #ifdef FREE_ON_QUIT
 static void vimb_cleanup(void);
 #endif
@@ -114,11 +118,17 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview);
 static void on_counted_matches(WebKitFindController *finder, guint count, Client *c);
 static gboolean on_permission_request(WebKitWebView *webview,
         WebKitPermissionRequest *request, Client *c);
-static void on_script_message_focus(WebKitUserContentManager *manager,
-        WebKitJavascriptResult *res, gpointer data);
 static gboolean profileOptionArgFunc(const gchar *option_name,
         const gchar *value, gpointer data, GError **error);
 
+/* A phase of the startup recorded by the --profile-startup option. */
+typedef struct {
+    const char *name;
+    gint64     start;       /* monotonic time in microseconds */
+    gint64     end;
+    gboolean   instant;     /* phase marks only a point in time */
+} StartupPhase;
+
 struct Vimb vb;
 
 /**
@@ -315,14 +325,7 @@ void vb_enter_prompt(Client *c, char id, const char *prompt, gboolean print_prom
  */
 Client *vb_get_client_for_page_id(guint64 pageid)
 {
-    Client *c;
-    /* Search for the client with the same page id. */
-    for (c = vb.clients; c && c->page_id != pageid; c = c->next);
-
-    if (c) {
-        return c;
-    }
-    return NULL;
+    return g_hash_table_lookup(vb.pages, &pageid);
 }
 
 /**
@@ -627,6 +630,11 @@ void vb_statusbar_update(Client *c)
 
     statusbar_update_downloads(c, status);
 
+    /* show the number of requests blocked by the web extension */
+    if (c->state.blocked_requests) {
+        g_string_append_printf(status, " [%u blocked]", c->state.blocked_requests);
+    }
+
     /* show the scroll status */
     if (c->state.scroll_max == 0) {
         g_string_append(status, " All");
@@ -642,6 +650,21 @@ void vb_statusbar_update(Client *c)
     g_string_free(status, TRUE);
 }
 
+/**
+ * Sets up vimb and shows a first client without loading a uri. This allows
+ * to run vimb from the benchmarks under tests/.
+ */
+Client *vb_setup(void)
+{
+    Client *c;
+
+    vimb_setup();
+    c = client_new(NULL);
+    client_show(NULL, c);
+
+    return c;
+}
+
 /**
  * Show the given url on the left of statusbar.
  */
@@ -702,11 +725,16 @@ static void client_destroy(Client *c)
     } else {
         vb.clients = c->next;
     }
+    g_hash_table_remove(vb.pages, &c->page_id);
 
     if (c->state.search.last_query) {
         g_free(c->state.search.last_query);
     }
 
+    /* Don't let pending calls and signals of the web extension refer to the
+     * client. */
+    ext_proxy_cancel(c);
+
     completion_cleanup(c);
     map_cleanup(c);
     register_cleanup(c);
@@ -734,6 +762,9 @@ static void client_destroy(Client *c)
 static Client *client_new(WebKitWebView *webview)
 {
     Client *c;
+    gint64 start, start_webview;
+
+    start = startup_phase_begin();
 
     /* create the client */
     /* Prepend the new client to the queue of clients. */
@@ -752,12 +783,19 @@ static Client *client_new(WebKitWebView *webview)
 #endif
 
     /* webview */
+    start_webview = startup_phase_begin();
     c->webview   = webview_new(c, webview);
+    startup_phase_end("webview_new", start_webview);
     c->finder    = webkit_web_view_get_find_controller(c->webview);
     g_signal_connect(c->finder, "counted-matches", G_CALLBACK(on_counted_matches), c);
 
     c->page_id   = webkit_web_view_get_page_id(c->webview);
     c->inspector = webkit_web_view_get_inspector(c->webview);
+    /* The key points to the page id of the client, so the client must be
+     * removed from the table before it's freed. */
+    g_hash_table_insert(vb.pages, &c->page_id, c);
+
+    startup_phase_end("client_new", start);
 
     return c;
 }
@@ -766,6 +804,9 @@ static void client_show(WebKitWebView *webview, Client *c)
 {
     GtkWidget *box;
     char *xid;
+    gint64 start, start_phase;
+
+    start = startup_phase_begin();
 
     c->window = create_window(c);
 
@@ -812,7 +853,9 @@ static void client_show(WebKitWebView *webview, Client *c)
      * allow to se the default values for different scopes. For now we can
      * init the settings not in client_new because we need the access to some
      * widget for some settings. */
+    start_phase = startup_phase_begin();
     setting_init(c);
+    startup_phase_end("setting_init", start_phase);
 
     gtk_widget_show_all(c->window);
     if (vb.embed) {
@@ -830,8 +873,26 @@ static void client_show(WebKitWebView *webview, Client *c)
 
     c->state.enable_register = TRUE;
 
-    /* read the config file */
-    ex_run_file(c, vb.files[FILES_CONFIG]);
+    /* Read the config file only for the first client. Changes done by the
+     * config are applied to the settings, maps and autocmds shared by all
+     * clients, so later clients got them already by setting_init(). */
+    if (!vb.shortcuts) {
+        start_phase  = startup_phase_begin();
+        vb.in_config = TRUE;
+        ex_run_file(c, vb.files[FILES_CONFIG]);
+        vb.in_config = FALSE;
+        startup_phase_end("ex_run_file", start_phase);
+
+        vb.shortcuts = shortcut_copy(c->config.shortcuts);
+        vb.handler   = handler_copy(c->handler);
+    } else {
+        shortcut_free(c->config.shortcuts);
+        c->config.shortcuts = shortcut_copy(vb.shortcuts);
+        handler_free(c->handler);
+        c->handler = handler_copy(vb.handler);
+    }
+
+    startup_phase_end("client_show", start);
 }
 
 static GtkWidget *create_window(Client *c)
@@ -1110,7 +1171,11 @@ static void on_webctx_init_web_extension(WebKitWebContext *webctx, gpointer data
 #endif
 
     name  = ext_proxy_init();
-    vdata = g_variant_new("(ms)", name);
+    /* Give the block lists directory only if it exists, so the extension
+     * does not need to set up the blocker at all without it. */
+    vdata = g_variant_new("(msms)", name,
+            g_file_test(vb.files[FILES_BLOCKLISTS], G_FILE_TEST_IS_DIR)
+            ? vb.files[FILES_BLOCKLISTS] : NULL);
     webkit_web_context_set_web_extensions_initialization_user_data(webctx, vdata);
 
     /* Setup the extension directory. */
@@ -1466,6 +1531,7 @@ static void on_webview_load_changed(WebKitWebView *webview,
             break;
 
         case WEBKIT_LOAD_COMMITTED:
+            startup_mark("load_committed");
             /* In case of HTTP authentication request we ignore the focus
              * changes so that the input mode can be set for the
              * authentication request. If the authentication dialog is filled
@@ -1498,6 +1564,8 @@ static void on_webview_load_changed(WebKitWebView *webview,
             break;
 
         case WEBKIT_LOAD_FINISHED:
+            startup_mark("load_finished");
+            vb.startup.done = TRUE;
 #ifdef FEATURE_AUTOCMD
             autocmd_run(c, AU_LOAD_FINISHED, raw_uri, NULL);
 #endif
@@ -1758,6 +1826,118 @@ static void update_urlbar(Client *c)
     g_string_free(str, TRUE);
 }
 
+/**
+ * Returns the start time for a startup phase to be recorded or 0 if no
+ * startup profile is recorded.
+ */
+static gint64 startup_phase_begin(void)
+{
+    if (!vb.startup.phases || vb.startup.done) {
+        return 0;
+    }
+    return g_get_monotonic_time();
+}
+
+/**
+ * Records the startup phase of given name that was started at start.
+ */
+static void startup_phase_end(const char *name, gint64 start)
+{
+    StartupPhase phase;
+
+    if (!start || !vb.startup.phases || vb.startup.done) {
+        return;
+    }
+
+    phase.name    = name;
+    phase.start   = start;
+    phase.end     = g_get_monotonic_time();
+    phase.instant = FALSE;
+    g_array_append_val(vb.startup.phases, phase);
+}
+
+/**
+ * Records the first occurrence of an event during startup.
+ */
+static void startup_mark(const char *name)
+{
+    StartupPhase phase;
+    guint i;
+
+    if (!vb.startup.phases || vb.startup.done) {
+        return;
+    }
+    for (i = 0; i < vb.startup.phases->len; i++) {
+        if (!strcmp(g_array_index(vb.startup.phases, StartupPhase, i).name, name)) {
+            return;
+        }
+    }
+
+    phase.name    = name;
+    phase.start   = phase.end = g_get_monotonic_time();
+    phase.instant = TRUE;
+    g_array_append_val(vb.startup.phases, phase);
+}
+
+/**
+ * Writes the recorded startup phases to the file given by --profile-startup.
+ * If the file name ends in .json, the phases are written in the Chrome trace
+ * event format, else as plain text with times in milliseconds relative to
+ * the start of vimb.
+ */
+static void startup_profile_write(void)
+{
+    GString *out;
+    StartupPhase *phase;
+    GError *error = NULL;
+    gboolean json;
+    int pid;
+    guint i;
+
+    if (!vb.startup.phases) {
+        return;
+    }
+
+    out  = g_string_new(NULL);
+    json = g_str_has_suffix(vb.startup.file, ".json");
+    pid  = (int)getpid();
+
+    if (json) {
+        g_string_append(out, "{\"traceEvents\":[\n");
+    } else {
+        g_string_append_printf(out, "# %-20s %12s %12s\n", "phase", "start/ms", "duration/ms");
+    }
+    for (i = 0; i < vb.startup.phases->len; i++) {
+        phase = &g_array_index(vb.startup.phases, StartupPhase, i);
+        if (json) {
+            g_string_append_printf(out,
+                    "%s{\"name\":\"%s\",\"cat\":\"startup\",\"pid\":%d,\"tid\":%d,\"ts\":%" G_GINT64_FORMAT,
+                    i ? ",\n" : "", phase->name, pid, pid, phase->start - vb.startup.base);
+            if (phase->instant) {
+                g_string_append(out, ",\"ph\":\"i\",\"s\":\"p\"}");
+            } else {
+                g_string_append_printf(out, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT "}",
+                        phase->end - phase->start);
+            }
+        } else {
+            g_string_append_printf(out, "  %-20s %12.3f %12.3f\n", phase->name,
+                    (phase->start - vb.startup.base) / 1000.0,
+                    (phase->end - phase->start) / 1000.0);
+        }
+    }
+    if (json) {
+        g_string_append(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    }
+
+    if (!g_file_set_contents(vb.startup.file, out->str, out->len, &error)) {
+        g_warning("Could not write startup profile: %s", error->message);
+        g_error_free(error);
+    }
+    g_string_free(out, TRUE);
+    g_array_free(vb.startup.phases, TRUE);
+    vb.startup.phases = NULL;
+}
+
 #ifdef FREE_ON_QUIT
 /**
  * Free memory of the whole application.
@@ -1769,9 +1949,15 @@ static void vimb_cleanup(void)
     while (vb.clients) {
         client_destroy(vb.clients);
     }
+    g_hash_table_destroy(vb.pages);
 
     /* free memory of other components */
     util_cleanup();
+    ex_cleanup();
+    if (vb.shortcuts) {
+        shortcut_free(vb.shortcuts);
+        handler_free(vb.handler);
+    }
 
     for (i = 0; i < STORAGE_LAST; i++) {
         file_storage_free(vb.storage[i]);
@@ -1782,6 +1968,7 @@ static void vimb_cleanup(void)
         }
     }
     g_free(vb.profile);
+    g_free(vb.startup.file);
 }
 #endif
 
@@ -1793,6 +1980,7 @@ static void vimb_setup(void)
     WebKitWebContext *ctx;
     WebKitCookieManager *cm;
     char *path;
+    gint64 start;
 
     /* prepare the file pathes */
     path = util_get_config_dir();
@@ -1810,6 +1998,7 @@ static void vimb_setup(void)
         vb.files[FILES_CLOSED] = g_build_filename(path, "closed", NULL);
         vb.files[FILES_COOKIE] = g_build_filename(path, "cookies.db", NULL);
     }
+    vb.files[FILES_BLOCKLISTS] = g_build_filename(path, "blocklists", NULL);
     vb.files[FILES_BOOKMARK]   = g_build_filename(path, "bookmark", NULL);
     vb.files[FILES_QUEUE]      = g_build_filename(path, "queue", NULL);
     vb.files[FILES_SCRIPT]     = g_build_filename(path, "scripts.js", NULL);
@@ -1820,9 +2009,12 @@ static void vimb_setup(void)
     vb.storage[STORAGE_SEARCH]   = file_storage_new(path, "search", vb.incognito);
     g_free(path);
 
+    vb.pages = g_hash_table_new(g_int64_hash, g_int64_equal);
+
     /* Use seperate rendering processed for the webview of the clients in the
      * current instance. This must be called as soon as possible according to
      * the documentation. */
+    start = startup_phase_begin();
     if (vb.incognito) {
         ctx = webkit_web_context_new_ephemeral();
     } else {
@@ -1841,6 +2033,7 @@ static void vimb_setup(void)
                 vb.files[FILES_COOKIE],
                 WEBKIT_COOKIE_PERSISTENT_STORAGE_SQLITE);
     }
+    startup_phase_end("web_context", start);
 
     /* initialize the modes */
     vb_mode_add('n', normal_enter, normal_leave, normal_keypress, NULL);
@@ -1896,7 +2089,7 @@ void vb_gui_style_update(Client *c, const char *setting_name_new, const char *se
         /* If the current style setting name is NOT the one being updated,
          * append the css string based on the current config setting. */
         else {
-            Setting* setting_value = (Setting*)g_hash_table_lookup(c->config.settings, setting_name);
+            Setting* setting_value = setting_get(c, setting_name);
 
             /* If the current style setting name is not available via settings
              * yet - this happens during setting_init() - cleanup and return.
@@ -1987,10 +2180,6 @@ static WebKitWebView *webview_new(Client *c, WebKitWebView *webview)
     webcontext = webkit_web_view_get_context(new);
     g_signal_connect(webcontext, "download-started", G_CALLBACK(on_webctx_download_started), c);
 
-    /* Setup script message handlers. */
-    webkit_user_content_manager_register_script_message_handler(ucm, "focus");
-    g_signal_connect(ucm, "script-message-received::focus", G_CALLBACK(on_script_message_focus), NULL);
-
     return new;
 }
 
@@ -2035,35 +2224,6 @@ static gboolean on_permission_request(WebKitWebView *webview,
     return TRUE;
 }
 
-static void on_script_message_focus(WebKitUserContentManager *manager,
-        WebKitJavascriptResult *res, gpointer data)
-{
-    char *message;
-    GVariant *variant;
-    guint64 pageid;
-    gboolean is_focused;
-    Client *c;
-
-    message = util_js_result_as_string(res);
-    variant = g_variant_parse(G_VARIANT_TYPE("(tb)"), message, NULL, NULL, NULL);
-    g_free(message);
-
-    g_variant_get(variant, "(tb)", &pageid, &is_focused);
-    g_variant_unref(variant);
-
-    c = vb_get_client_for_page_id(pageid);
-    if (!c || c->mode->flags & FLAG_IGNORE_FOCUS) {
-        return;
-    }
-
-    /* Don't change the mode if we are in pass through mode. */
-    if (c->mode->id == 'n' && is_focused) {
-        vb_enter(c, 'i');
-    } else if (c->mode->id == 'i' && !is_focused) {
-        vb_enter(c, 'n');
-    }
-}
-
 static gboolean profileOptionArgFunc(const gchar *option_name,
         const gchar *value, gpointer data, GError **error)
 {
@@ -2078,6 +2238,7 @@ int main(int argc, char* argv[])
     GError *err = NULL;
     char *pidstr, *winid = NULL;
     gboolean ver = FALSE, buginfo = FALSE;
+    gint64 start;
 
     GOptionEntry opts[] = {
         {"config", 'c', 0, G_OPTION_ARG_FILENAME, &vb.configfile, "Custom configuration file", NULL},
@@ -2087,9 +2248,12 @@ int main(int argc, char* argv[])
         {"version", 'v', 0, G_OPTION_ARG_NONE, &ver, "Print version", NULL},
         {"no-maximize", 0, 0, G_OPTION_ARG_NONE, &vb.no_maximize, "Do no attempt to maximize window", NULL},
         {"bug-info", 0, 0, G_OPTION_ARG_NONE, &buginfo, "Print used library versions", NULL},
+        {"profile-startup", 0, 0, G_OPTION_ARG_FILENAME, &vb.startup.file, "Write timeline of the startup phases to FILE", "FILE"},
         {NULL}
     };
 
+    vb.startup.base = g_get_monotonic_time();
+
     /* initialize GTK+ */
     if (!gtk_init_with_args(&argc, &argv, "[URI]", opts, NULL, &err)) {
         fprintf(stderr, "can't init gtk: %s\n", err->message);
@@ -2135,6 +2299,11 @@ int main(int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
+    if (vb.startup.file) {
+        vb.startup.phases = g_array_new(FALSE, FALSE, sizeof(StartupPhase));
+        startup_phase_end("gtk_init", vb.startup.base);
+    }
+
     /* Save the base name for spawning new instances. */
     vb.argv0 = argv[0];
 
@@ -2143,7 +2312,9 @@ int main(int argc, char* argv[])
     g_setenv("VIMB_PID", pidstr, TRUE);
     g_free(pidstr);
 
+    start = startup_phase_begin();
     vimb_setup();
+    startup_phase_end("vimb_setup", start);
 
     if (winid) {
         vb.embed = strtol(winid, NULL, 0);
@@ -2161,6 +2332,8 @@ int main(int argc, char* argv[])
     }
 
     gtk_main();
+
+    startup_profile_write();
 #ifdef FREE_ON_QUIT
     vimb_cleanup();
 #endif
@@ -27,15 +27,16 @@
 #include "shortcut.h"
 #include "handler.h"
 #include "file-storage.h"
+#include "webextension/ext-main.h"
 
 #include "config.h"
 
 #define LENGTH(x) (sizeof x / sizeof x[0])
 #define OVERWRITE_STRING(t, s) {if (t) g_free(t); t = g_strdup(s);}
 #define OVERWRITE_NSTRING(t, s, l) {if (t) {g_free(t); t = NULL;} t = g_strndup(s, l);}
-#define GET_CHAR(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.s)
-#define GET_INT(c, n)   (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.i)
-#define GET_BOOL(c, n)  (((Setting*)g_hash_table_lookup(c->config.settings, n))->value.b)
+#define GET_CHAR(c, n)  (setting_get(c, n)->value.s)
+#define GET_INT(c, n)   (setting_get(c, n)->value.i)
+#define GET_BOOL(c, n)  (setting_get(c, n)->value.b)
 
 
 #ifdef DEBUG
@@ -104,6 +105,7 @@ typedef enum {
 } VbInputType;
 
 enum {
+    FILES_BLOCKLISTS,
     FILES_BOOKMARK,
     FILES_CLOSED,
     FILES_CONFIG,
@@ -174,6 +176,7 @@ struct State {
     glong               scroll_max;         /* Maxmimum scrollable height of the document. */
     guint               scroll_percent;     /* Current position of the viewport in document (percent). */
     glong               scroll_top;         /* Current position of the viewport in document (pixel). */
+    guint               blocked_requests;   /* Number of requests blocked for the current page. */
     char                *title;             /* Window title of the client. */
 
     char                *reg[REG_SIZE];     /* holds the yank buffers */
@@ -223,7 +226,8 @@ struct Statusbar {
     GtkWidget *mode, *left, *right, *cmd;
 };
 
-struct AuGroup;
+struct AuTable;
+struct MapTable;
 
 struct Client {
     struct Client       *next;
@@ -239,12 +243,20 @@ struct Client {
     guint64             page_id;                /* page id of the webview */
     GtkTextBuffer       *buffer;
     GDBusProxy          *dbusproxy;
+    GQueue              *dbuscalls;             /* calls waiting for the dbusproxy */
+    GCancellable        *dbuscancel;            /* cancels the pending dbus calls */
+    guint               dbusscroll;             /* VerticalScroll subscription */
+    guint               dbusfocus;              /* EditableFocus subscription */
+    guint               dbusblocked;            /* RequestsBlocked subscription */
+    struct {
+        VbScrollState   *state;                 /* written by the web extension */
+        int             doorbell;               /* readable after state changed */
+        guint           watch;                  /* source watching the doorbell */
+    } shared;
     GDBusServer         *dbusserver;
     Handler             *handler;               /* the protocoll handlers */
     struct {
-        /* TODO split in global setting definitions and set values on a per
-         * client base. */
-        GHashTable              *settings;
+        GHashTable              *settings;      /* settings changed locally */
         guint                   scrollstep;
         gboolean                input_autohide;
         gboolean                incsearch;
@@ -253,7 +265,7 @@ struct Client {
         Shortcut                *shortcuts;
     } config;
     struct {
-        GSList      *list;
+        struct MapTable *table;                 /* shared or client local maps */
         GString     *queue;                     /* queue holding typed keys */
         int         qlen;                       /* pointer to last char in queue */
         int         resolved;                   /* number of resolved keys (no mapping required) */
@@ -262,15 +274,22 @@ struct Client {
         guint       timeoutlen;                 /* timeout for ambiguous mappings */
     } map;
     struct {
-        struct AuGroup *curgroup;
-        GSList         *groups;
-        guint          usedbits;                /* holds all used event bits */
+        /* holds the settings if JavaScript can open windows automatically
+         * and is enabled that we have to change to fire hints */
+        gboolean        allow_open_win;
+        gboolean        allow_javascript;
+        gboolean        restore;                /* settings are restored after hints are cleared */
+    } hints;
+    struct {
+        char           *curgroup;               /* name of the current group */
+        struct AuTable *table;                  /* shared or client local autocmds */
     } autocmd;
 };
 
 struct Vimb {
     char        *argv0;
     Client      *clients;
+    GHashTable  *pages;             /* clients by the page id of the webview */
     Window      embed;
     GHashTable  *modes;             /* all available browser main modes */
     char        *configfile;        /* config file given as option on startup */
@@ -284,6 +303,18 @@ struct Vimb {
     GtkCssProvider *style_provider;
     gboolean    no_maximize;
     gboolean    incognito;
+    gboolean    in_config;         /* indicates that the config file is run */
+    /* Shortcuts and handlers after the config file was run. These are
+     * copied to the clients created later, because the config file is run
+     * only once. */
+    Shortcut    *shortcuts;
+    Handler     *handler;
+    struct {
+        char        *file;          /* file to write the startup profile to */
+        GArray      *phases;        /* recorded startup phases */
+        gint64      base;           /* monotonic time vimb was started */
+        gboolean    done;           /* the first page load is finished */
+    } startup;
 };
 
 gboolean vb_download_set_destination(Client *c, WebKitDownload *download,
@@ -303,6 +334,7 @@ VbResult vb_mode_handle_key(Client *c, int key);
 void vb_modelabel_update(Client *c, const char *label);
 gboolean vb_quit(Client *c, gboolean force);
 void vb_register_add(Client *c, char buf, const char *value);
+Client *vb_setup(void);
 const char *vb_register_get(Client *c, char buf);
 void vb_statusbar_update(Client *c);
 void vb_statusbar_show_hover_url(Client *c, VbLinkType type, const char *uri);
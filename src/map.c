@@ -27,12 +27,20 @@
 #include "map.h"
 #include "util.h"
 
+/* List of maps that might be shared by multiple clients. */
+struct MapTable {
+    GSList *list;
+    int    refcount;
+};
+
 static char *convert_keylabel(const char *in, int inlen, int *len);
 static char *convert_keys(const char *in, int inlen, int *len);
 static gboolean do_timeout(Client *c);
 static void free_map(Map *map);
 static int keyval_to_string(guint keyval, guint state, guchar *string);
 static gboolean map_delete_by_lhs(Client *c, const char *lhs, int len, char mode);
+static struct MapTable *get_table(Client *c);
+static void table_unref(struct MapTable *table);
 static void showcmd(Client *c, int ch);
 static char *transchar(int c);
 static int utf_char2bytes(guint c, guchar *buf);
@@ -107,8 +115,18 @@ static struct {
     gboolean processing; /* whether or not events are processing */
 } events = {0};
 
+/* The maps defined by the config file, which are shared by all clients that
+ * did not change their maps locally. */
+static struct MapTable *shared = NULL;
+
 void map_init(Client *c)
 {
+    if (!shared) {
+        shared = g_slice_new0(struct MapTable);
+    }
+    shared->refcount++;
+    c->map.table = shared;
+
     c->map.queue = g_string_sized_new(50);
     /* TODO move this to settings */
     c->map.timeoutlen = 1000;
@@ -116,8 +134,9 @@ void map_init(Client *c)
 
 void map_cleanup(Client *c)
 {
-    if (c->map.list) {
-        g_slist_free_full(c->map.list, (GDestroyNotify)free_map);
+    if (c->map.table) {
+        table_unref(c->map.table);
+        c->map.table = NULL;
     }
     if (c->map.queue) {
         g_string_free(c->map.queue, TRUE);
@@ -206,7 +225,7 @@ MapState map_handle_keys(Client *c, const guchar *keys, int keylen, gboolean use
         match     = NULL;
         ambiguous = 0;
         if (use_map && !(c->mode->flags & FLAG_NOMAP)) {
-            for (GSList *l = c->map.list; l != NULL; l = l->next) {
+            for (GSList *l = c->map.table->list; l != NULL; l = l->next) {
                 Map *m = (Map*)l->data;
                 /* ignore maps for other modes */
                 if (m->mode != c->mode->id) {
@@ -305,6 +324,7 @@ void map_insert(Client *c, const char *in, const char *mapped, char mode, gboole
     int inlen, mappedlen;
     char *lhs = convert_keys(in, strlen(in), &inlen);
     char *rhs = convert_keys(mapped, strlen(mapped), &mappedlen);
+    struct MapTable *table = get_table(c);
 
     /* if lhs was already mapped, remove this first */
     map_delete_by_lhs(c, lhs, inlen, mode);
@@ -317,7 +337,7 @@ void map_insert(Client *c, const char *in, const char *mapped, char mode, gboole
     new->mode      = mode;
     new->remap     = remap;
 
-    c->map.list = g_slist_prepend(c->map.list, new);
+    table->list = g_slist_prepend(table->list, new);
 }
 
 gboolean map_delete(Client *c, const char *in, char mode)
@@ -580,13 +600,15 @@ static int keyval_to_string(guint keyval, guint state, guchar *string)
 
 static gboolean map_delete_by_lhs(Client *c, const char *lhs, int len, char mode)
 {
-    for (GSList *l = c->map.list; l != NULL; l = l->next) {
+    struct MapTable *table = get_table(c);
+
+    for (GSList *l = table->list; l != NULL; l = l->next) {
         Map *m = (Map*)l->data;
 
         /* remove only if the map's lhs matches the given key sequence */
         if (m->mode == mode && m->inlen == len && !strcmp(m->in, lhs)) {
             /* remove the found list item */
-            c->map.list = g_slist_delete_link(c->map.list, l);
+            table->list = g_slist_delete_link(table->list, l);
             free_map(m);
             return TRUE;
         }
@@ -594,6 +616,50 @@ static gboolean map_delete_by_lhs(Client *c, const char *lhs, int len, char mode
     return FALSE;
 }
 
+/**
+ * Returns the maps of the client that are going to be changed. Changes done
+ * by the config file are applied to the shared maps. For all other changes
+ * the client gets an own copy of the maps.
+ */
+static struct MapTable *get_table(Client *c)
+{
+    struct MapTable *table;
+    Map *m, *copy;
+
+    if (c->map.table != shared || vb.in_config) {
+        return c->map.table;
+    }
+
+    table = g_slice_new0(struct MapTable);
+    table->refcount = 1;
+    for (GSList *l = shared->list; l; l = l->next) {
+        m    = (Map*)l->data;
+        copy = g_slice_dup(Map, m);
+        copy->in     = g_strndup(m->in, m->inlen);
+        copy->mapped = g_strndup(m->mapped, m->mappedlen);
+
+        table->list = g_slist_prepend(table->list, copy);
+    }
+    table->list = g_slist_reverse(table->list);
+
+    table_unref(c->map.table);
+    c->map.table = table;
+
+    return table;
+}
+
+static void table_unref(struct MapTable *table)
+{
+    if (--table->refcount > 0) {
+        return;
+    }
+    if (table == shared) {
+        shared = NULL;
+    }
+    g_slist_free_full(table->list, (GDestroyNotify)free_map);
+    g_slice_free(struct MapTable, table);
+}
+
 /**
  * Put the given char onto the show command buffer.
  */
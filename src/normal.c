@@ -27,7 +27,6 @@
 #include "ext-proxy.h"
 #include "main.h"
 #include "normal.h"
-#include "scripts/scripts.h"
 #include "util.h"
 #include "ext-proxy.h"
 
@@ -324,7 +323,7 @@ void pass_enter(Client *c)
  */
 void pass_leave(Client *c)
 {
-    ext_proxy_eval_script(c, "document.activeElement.blur();", NULL);
+    ext_proxy_call_js(c, VB_JS_BLUR_ACTIVE, NULL, NULL, NULL);
     vb_modelabel_update(c, "");
 }
 
@@ -435,7 +434,7 @@ static VbResult normal_fire(Client *c, const NormalCmdInfo *info)
      * highlight. We use the search_matches as indicator that the searching is
      * active. */
     if (c->state.search.active) {
-        ext_proxy_eval_script(c, "getSelection().anchorNode.parentNode.click();", NULL);
+        ext_proxy_call_js(c, VB_JS_CLICK_SELECTION, NULL, NULL, NULL);
 
         return RESULT_COMPLETE;
     }
@@ -504,12 +503,10 @@ static VbResult normal_do_hint(Client *c, const char *prompt)
 
 static VbResult normal_increment_decrement(Client *c, const NormalCmdInfo *info)
 {
-    char *js;
     int count = info->count ? info->count : 1;
 
-    js = g_strdup_printf(JS_INCREMENT_URI_NUMBER, info->key == CTRL('A') ? count : -count);
-    ext_proxy_eval_script(c, js, NULL);
-    g_free(js);
+    ext_proxy_call_js(c, VB_JS_INCREMENT_URI, g_variant_new("(i)",
+                info->key == CTRL('A') ? count : -count), NULL, NULL);
 
     return RESULT_COMPLETE;
 }
@@ -533,7 +530,7 @@ static VbResult normal_input_open(Client *c, const NormalCmdInfo *info)
 static VbResult normal_mark(Client *c, const NormalCmdInfo *info)
 {
     glong current;
-    char *js, *mark;
+    char *mark;
     int idx;
 
     /* check if the second char is a valid mark char */
@@ -555,9 +552,8 @@ static VbResult normal_mark(Client *c, const NormalCmdInfo *info)
         current = c->state.scroll_top;
 
         /* jump to the location */
-        js = g_strdup_printf("window.scroll(window.screenLeft,%ld);", c->state.marks[idx]);
-        ext_proxy_eval_script(c, js, NULL);
-        g_free(js);
+        ext_proxy_call_js(c, VB_JS_SCROLL_TO,
+                g_variant_new("(x)", (gint64)c->state.marks[idx]), NULL, NULL);
 
         /* save previous adjust as last position */
         c->state.marks[MARK_TICK] = current;
@@ -692,11 +688,10 @@ static VbResult normal_quit(Client *c, const NormalCmdInfo *info)
 
 static VbResult normal_scroll(Client *c, const NormalCmdInfo *info)
 {
-    char *js;
+    char mode[2] = {info->key, '\0'};
 
-    js = g_strdup_printf("vbscroll('%c',%d,%d);", info->key, c->config.scrollstep, info->count);
-    ext_proxy_eval_script(c, js, NULL);
-    g_free(js);
+    ext_proxy_call_js(c, VB_JS_SCROLL, g_variant_new("(sui)", mode,
+                c->config.scrollstep, info->count), NULL, NULL);
 
     return RESULT_COMPLETE;
 }
@@ -0,0 +1,259 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <string.h>
+
+#include "keyword-set.h"
+#include "pattern-set.h"
+#include "util.h"
+
+/*
+ * The pattern set matches a subject against many wildcard patterns at once.
+ * From each pattern the longest literal string is taken that must be part of
+ * all the subjects the pattern matches. These strings are put into a keyword
+ * set, so that one pass over the subject finds the patterns that might
+ * match. Only those are matched for real.
+ */
+
+typedef struct {
+    Pattern  *matcher;
+    gpointer data;
+    char     **fragments;   /* literals required for a match or NULL */
+    guint    mark;          /* generation a fragment of this was found */
+} Entry;
+
+struct patternset {
+    GPtrArray  *entries;    /* the entries in the order they where added */
+    KeywordSet *keywords;   /* fragments of the entries */
+    gboolean   dirty;       /* the keywords must be rebuilt */
+    guint      gen;
+};
+
+static void build(PatternSet *set);
+static gboolean mark_entry(Entry *entry, gsize end, PatternSet *set);
+static char **get_fragments(const char *pattern);
+static void keep_longest(GString *best, GString *run);
+static void free_entry(Entry *entry);
+
+
+PatternSet *pattern_set_new(void)
+{
+    PatternSet *set = g_slice_new0(PatternSet);
+    set->entries    = g_ptr_array_new_with_free_func((GDestroyNotify)free_entry);
+    set->keywords   = keyword_set_new();
+    set->dirty      = TRUE;
+
+    return set;
+}
+
+void pattern_set_free(PatternSet *set)
+{
+    keyword_set_free(set->keywords);
+    g_ptr_array_unref(set->entries);
+    g_slice_free(PatternSet, set);
+}
+
+/**
+ * Adds the pattern to the set. The data is returned by pattern_set_match()
+ * if the pattern matches.
+ */
+void pattern_set_add(PatternSet *set, const char *pattern, gpointer data)
+{
+    Entry *entry = g_slice_new0(Entry);
+
+    entry->matcher   = util_pattern_new(pattern);
+    entry->data      = data;
+    entry->fragments = get_fragments(pattern);
+
+    g_ptr_array_add(set->entries, entry);
+    set->dirty = TRUE;
+}
+
+/**
+ * Removes all the patterns that where added with given data.
+ */
+void pattern_set_remove(PatternSet *set, gpointer data)
+{
+    guint i;
+
+    for (i = set->entries->len; i > 0; i--) {
+        if (((Entry*)g_ptr_array_index(set->entries, i - 1))->data == data) {
+            g_ptr_array_remove_index(set->entries, i - 1);
+            set->dirty = TRUE;
+        }
+    }
+}
+
+/**
+ * Retrieves the data of all patterns matching the subject in the order the
+ * patterns where added.
+ * Returned list must be freed with g_slist_free().
+ */
+GSList *pattern_set_match(PatternSet *set, const char *subject)
+{
+    GSList *result = NULL;
+    Entry *entry;
+    guint i;
+
+    if (set->dirty) {
+        build(set);
+    }
+
+    /* mark all the entries with a fragment found in the subject */
+    if (!++set->gen) {
+        for (i = 0; i < set->entries->len; i++) {
+            ((Entry*)g_ptr_array_index(set->entries, i))->mark = 0;
+        }
+        set->gen = 1;
+    }
+    keyword_set_search(set->keywords, subject, -1,
+            (KeywordSetFunc)mark_entry, set);
+
+    /* verify the candidates */
+    for (i = set->entries->len; i > 0; i--) {
+        entry = g_ptr_array_index(set->entries, i - 1);
+        if ((!entry->fragments || entry->mark == set->gen)
+            && util_pattern_match(entry->matcher, subject)
+        ) {
+            result = g_slist_prepend(result, entry->data);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Rebuilds the keyword set from the fragments of all the entries.
+ */
+static void build(PatternSet *set)
+{
+    Entry *entry;
+    char **fragment;
+    guint i;
+
+    keyword_set_clear(set->keywords);
+    for (i = 0; i < set->entries->len; i++) {
+        entry = g_ptr_array_index(set->entries, i);
+        for (fragment = entry->fragments; fragment && *fragment; fragment++) {
+            keyword_set_add(set->keywords, *fragment, strlen(*fragment), entry);
+        }
+    }
+
+    set->dirty = FALSE;
+}
+
+static gboolean mark_entry(Entry *entry, gsize end, PatternSet *set)
+{
+    entry->mark = set->gen;
+
+    return FALSE;
+}
+
+/**
+ * Retrieves the longest literal string of each alternative of the pattern,
+ * that must be contained in all the subjects the alternative matches.
+ * Returns NULL if there is an alternative without such a string, because
+ * the pattern has to be tested on each subject then.
+ */
+static char **get_fragments(const char *pattern)
+{
+    GPtrArray *fragments = g_ptr_array_new();
+    GString *run    = g_string_new(NULL);
+    GString *best   = g_string_new(NULL);
+    gboolean inlist = FALSE, failed = FALSE;
+    const char *s, *start;
+
+    for (s = start = pattern; ; s++) {
+        if (inlist && *s) {
+            /* the items of lists are optional - so they are skipped */
+            if (*s == '\\' && s[1] && strchr(",{}", s[1])) {
+                s++;
+            } else if (*s == '}') {
+                inlist = FALSE;
+            }
+            continue;
+        }
+        if (!*s || *s == ',') {
+            keep_longest(best, run);
+            /* empty alternatives are ignored */
+            if (s > start) {
+                if (!best->len) {
+                    failed = TRUE;
+                    break;
+                }
+                g_ptr_array_add(fragments, g_strdup(best->str));
+                g_string_truncate(best, 0);
+            }
+            if (!*s) {
+                break;
+            }
+            start = s + 1;
+            continue;
+        }
+        switch (*s) {
+            case '{':
+                inlist = TRUE;
+                /* fall through */
+            case '*':
+            case '?':
+            case '}':
+                keep_longest(best, run);
+                break;
+
+            case '\\':
+                if (s[1] && strchr("*?{},", s[1])) {
+                    s++;
+                }
+                /* fall through */
+            default:
+                g_string_append_c(run, g_ascii_tolower(*s));
+                break;
+        }
+    }
+    g_string_free(run, TRUE);
+    g_string_free(best, TRUE);
+
+    if (failed || !fragments->len) {
+        g_ptr_array_set_free_func(fragments, g_free);
+        g_ptr_array_unref(fragments);
+        return NULL;
+    }
+    g_ptr_array_add(fragments, NULL);
+
+    return (char**)g_ptr_array_free(fragments, FALSE);
+}
+
+/**
+ * Keeps the run of literal chars if it is longer than the best one found so
+ * far and starts a new run.
+ */
+static void keep_longest(GString *best, GString *run)
+{
+    if (run->len > best->len) {
+        g_string_assign(best, run->str);
+    }
+    g_string_truncate(run, 0);
+}
+
+static void free_entry(Entry *entry)
+{
+    util_pattern_free(entry->matcher);
+    g_strfreev(entry->fragments);
+    g_slice_free(Entry, entry);
+}
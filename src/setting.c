@@ -39,10 +39,32 @@ typedef enum {
 } SettingType;
 
 enum {
-    FLAG_LIST  = (1<<1),    /* setting contains a ',' separated list of values */
-    FLAG_NODUP = (1<<2),    /* don't allow duplicate strings within list values */
+    FLAG_LIST   = (1<<1),   /* setting contains a ',' separated list of values */
+    FLAG_NODUP  = (1<<2),   /* don't allow duplicate strings within list values */
+    FLAG_CLIENT = (1<<3),   /* data is the offset of a field in the client */
 };
 
+/* offset of a client field to be used as data for FLAG_CLIENT settings */
+#define CLIENT_FIELD(f) GSIZE_TO_POINTER(G_STRUCT_OFFSET(Client, f))
+
+/* The setting definitions with the values set by the defaults and the config
+ * file are shared by all clients. If a client changes a setting, it gets an
+ * own copy of the setting in c->config.settings. */
+static struct {
+    GHashTable *settings;
+    GSList     *list;       /* settings in order of their definition */
+    int        refcount;    /* number of clients using the settings */
+} global = {NULL, NULL, 0};
+
+/* WebKitSettings that collects the webkit settings during setting_init().
+ * These are attached to the webview at once after all the values are set. */
+static WebKitSettings *batch = NULL;
+
+static void setting_define(Client *c);
+static void setting_apply(Client *c, Setting *prop);
+static Setting *setting_get_local(Client *c, Setting *prop);
+static void *setting_data(Client *c, Setting *prop);
+static WebKitSettings *get_web_settings(Client *c);
 static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type);
 static gboolean prepare_setting_value(Setting *prop, void *value, SettingType type, void **newvalue);
 static gboolean setting_add(Client *c, const char *name, DataType type, void *value,
@@ -72,102 +94,24 @@ extern struct Vimb vb;
 
 void setting_init(Client *c)
 {
-    int i;
-    gboolean on = TRUE, off = FALSE;
-
     c->config.settings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)setting_free);
-    setting_add(c, "user-agent", TYPE_CHAR, &"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/11.0 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent");
-    /* TODO use the real names for webkit settings */
-    i = 14;
-    setting_add(c, "accelerated-2d-canvas", TYPE_BOOLEAN, &off, webkit, 0, "enable-accelerated-2d-canvas");
-    setting_add(c, "allow-file-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-file-access-from-file-urls");
-    setting_add(c, "allow-universal-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-universal-access-from-file-urls");
-    setting_add(c, "caret", TYPE_BOOLEAN, &off, webkit, 0, "enable-caret-browsing");
-    setting_add(c, "cursiv-font", TYPE_CHAR, &"serif", webkit, 0, "cursive-font-family");
-    setting_add(c, "default-charset", TYPE_CHAR, &"utf-8", webkit, 0, "default-charset");
-    setting_add(c, "default-font", TYPE_CHAR, &"sans-serif", webkit, 0, "default-font-family");
-    setting_add(c, "dns-prefetching", TYPE_BOOLEAN, &on, webkit, 0, "enable-dns-prefetching");
-    i = SETTING_DEFAULT_FONT_SIZE;
-    setting_add(c, "font-size", TYPE_INTEGER, &i, webkit, 0, "default-font-size");
-    setting_add(c, "frame-flattening", TYPE_BOOLEAN, &off, webkit, 0, "enable-frame-flattening");
-    setting_add(c, "hardware-acceleration-policy", TYPE_CHAR, &"ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL);
-    setting_add(c, "header", TYPE_CHAR, &"", headers, FLAG_LIST|FLAG_NODUP, "header");
-    i = 1000;
-    setting_add(c, "hint-timeout", TYPE_INTEGER, &i, NULL, 0, NULL);
-    setting_add(c, "hint-keys", TYPE_CHAR, &"0123456789", NULL, 0, NULL);
-    setting_add(c, "hint-follow-last", TYPE_BOOLEAN, &on, NULL, 0, NULL);
-    setting_add(c, "hint-keys-same-length", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "html5-database", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-database");
-    setting_add(c, "html5-local-storage", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-local-storage");
-    setting_add(c, "hyperlink-auditing", TYPE_BOOLEAN, &off, webkit, 0, "enable-hyperlink-auditing");
-    setting_add(c, "images", TYPE_BOOLEAN, &on, webkit, 0, "auto-load-images");
-    setting_add(c, "javascript-can-access-clipboard", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-access-clipboard");
-    setting_add(c, "javascript-can-open-windows-automatically", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-open-windows-automatically");
-    setting_add(c, "media-playback-allows-inline", TYPE_BOOLEAN, &on, webkit, 0, "media-playback-allows-inline");
-    setting_add(c, "media-playback-requires-user-gesture", TYPE_BOOLEAN, &off, webkit, 0, "media-playback-requires-user-gesture");
-    setting_add(c, "media-stream", TYPE_BOOLEAN, &off, webkit, 0, "enable-media-stream");
-    setting_add(c, "mediasource", TYPE_BOOLEAN, &off, webkit, 0, "enable-mediasource");
-    i = 5;
-    setting_add(c, "minimum-font-size", TYPE_INTEGER, &i, webkit, 0, "minimum-font-size");
-    setting_add(c, "monospace-font", TYPE_CHAR, &"monospace", webkit, 0, "monospace-font-family");
-    i = SETTING_DEFAULT_MONOSPACE_FONT_SIZE;
-    setting_add(c, "monospace-font-size", TYPE_INTEGER, &i, webkit, 0, "default-monospace-font-size");
-    setting_add(c, "offline-cache", TYPE_BOOLEAN, &on, webkit, 0, "enable-offline-web-application-cache");
-    setting_add(c, "plugins", TYPE_BOOLEAN, &on, webkit, 0, "enable-plugins");
-    setting_add(c, "prevent-newwindow", TYPE_BOOLEAN, &off, internal, 0, &c->config.prevent_newwindow);
-    setting_add(c, "print-backgrounds", TYPE_BOOLEAN, &on, webkit, 0, "print-backgrounds");
-    setting_add(c, "sans-serif-font", TYPE_CHAR, &"sans-serif", webkit, 0, "sans-serif-font-family");
-    setting_add(c, "scripts", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript");
-    setting_add(c, "serif-font", TYPE_CHAR, &"serif", webkit, 0, "serif-font-family");
-    setting_add(c, "site-specific-quirks", TYPE_BOOLEAN, &off, webkit, 0, "enable-site-specific-quirks");
-    setting_add(c, "smooth-scrolling", TYPE_BOOLEAN, &off, webkit, 0, "enable-smooth-scrolling");
-    setting_add(c, "spacial-navigation", TYPE_BOOLEAN, &off, webkit, 0, "enable-spatial-navigation");
-    setting_add(c, "tabs-to-links", TYPE_BOOLEAN, &on, webkit, 0, "enable-tabs-to-links");
-    setting_add(c, "webaudio", TYPE_BOOLEAN, &off, webkit, 0, "enable-webaudio");
-    setting_add(c, "webgl", TYPE_BOOLEAN, &off, webkit, 0, "enable-webgl");
-    setting_add(c, "webinspector", TYPE_BOOLEAN, &on, webkit, 0, "enable-developer-extras");
-    setting_add(c, "xss-auditor", TYPE_BOOLEAN, &on, webkit, 0, "enable-xss-auditor");
 
-    /* internal variables */
-    setting_add(c, "stylesheet", TYPE_BOOLEAN, &on, user_style, 0, NULL);
-    setting_add(c, "user-scripts", TYPE_BOOLEAN, &on, user_scripts, 0, NULL);
-    setting_add(c, "cookie-accept", TYPE_CHAR, &"always", cookie_accept, 0, NULL);
-    i = 40;
-    setting_add(c, "scroll-step", TYPE_INTEGER, &i, internal, 0, &c->config.scrollstep);
-    setting_add(c, "home-page", TYPE_CHAR, &SETTING_HOME_PAGE, NULL, 0, NULL);
-    i = 2000;
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "history-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.history_max);
-    setting_add(c, "editor-command", TYPE_CHAR, &"x-terminal-emulator -e -vi '%s'", NULL, 0, NULL);
-    setting_add(c, "strict-ssl", TYPE_BOOLEAN, &on, tls_policy, 0, NULL);
-    setting_add(c, "status-bar", TYPE_BOOLEAN, &on, statusbar, 0, NULL);
-    i = 1000;
-    setting_add(c, "timeoutlen", TYPE_INTEGER, &i, internal, 0, &c->map.timeoutlen);
-    setting_add(c, "input-autohide", TYPE_BOOLEAN, &off, input_autohide, 0, &c->config.input_autohide);
-    setting_add(c, "fullscreen", TYPE_BOOLEAN, &off, fullscreen, 0, NULL);
-    setting_add(c, "show-titlebar", TYPE_BOOLEAN, &on, window_decorate, 0, NULL);
-    i = 100;
-    setting_add(c, "default-zoom", TYPE_INTEGER, &i, default_zoom, 0, NULL);
-    setting_add(c, "download-path", TYPE_CHAR, &"~/", NULL, 0, NULL);
-    setting_add(c, "download-command", TYPE_CHAR, &"/bin/sh -c \"curl -sLJOC - -e '$VIMB_URI' %s\"", NULL, 0, NULL);
-    setting_add(c, "download-use-external", TYPE_BOOLEAN, &off, NULL, 0, NULL);
-    setting_add(c, "incsearch", TYPE_BOOLEAN, &off, internal, 0, &c->config.incsearch);
-    i = 10;
-    /* TODO should be global and not overwritten by a new client */
-    setting_add(c, "closed-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.closed_max);
-    setting_add(c, "x-hint-command", TYPE_CHAR, &":o <C-R>;", NULL, 0, NULL);
-    setting_add(c, "spell-checking", TYPE_BOOLEAN, &off, webkit_spell_checking, 0, NULL);
-    setting_add(c, "spell-checking-languages", TYPE_CHAR, &"en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL);
+    /* Each change of the webviews settings is propagated to the web process,
+     * so collect them in a new object that is not attached to a webview. */
+    batch = webkit_settings_new();
 
-    /* gui style settings vimb */
-    setting_add(c, "completion-css", TYPE_CHAR, &"color:#fff;background-color:#656565;font:" SETTING_GUI_FONT_NORMAL, gui_style, 0, NULL);
-    setting_add(c, "completion-hover-css", TYPE_CHAR, &"background-color:#777;", gui_style, 0, NULL);
-    setting_add(c, "completion-selected-css", TYPE_CHAR, &"color:#f6f3e8;background-color:#888;", gui_style, 0, NULL);
-    setting_add(c, "input-css", TYPE_CHAR, &"background-color:#fff;color:#000;font:" SETTING_GUI_FONT_NORMAL, gui_style, 0, NULL);
-    setting_add(c, "input-error-css", TYPE_CHAR, &"background-color:#f77;font:" SETTING_GUI_FONT_EMPH, gui_style, 0, NULL);
-    setting_add(c, "status-css", TYPE_CHAR, &"color:#fff;background-color:#000;font:" SETTING_GUI_FONT_EMPH, gui_style, 0, NULL);
-    setting_add(c, "status-ssl-css", TYPE_CHAR, &"background-color:#95e454;color:#000;", gui_style, 0, NULL);
-    setting_add(c, "status-ssl-invalid-css", TYPE_CHAR, &"background-color:#f77;color:#000;", gui_style, 0, NULL);
+    if (global.refcount++) {
+        /* settings are already defined - apply their values to the client */
+        for (GSList *l = global.list; l; l = l->next) {
+            setting_apply(c, (Setting*)l->data);
+        }
+    } else {
+        setting_define(c);
+    }
+
+    webkit_web_view_set_settings(c->webview, batch);
+    g_object_unref(batch);
+    batch = NULL;
 
     /* initialize the shortcuts and set the default shortcuts */
     shortcut_add(c->config.shortcuts, "dl", "https://duckduckgo.com/html/?q=$0");
@@ -175,6 +119,21 @@ void setting_init(Client *c)
     shortcut_set_default(c->config.shortcuts, "dl");
 }
 
+/**
+ * Retrieves the setting of given name. This is the clients own setting if it
+ * was changed locally or the global one.
+ */
+Setting *setting_get(Client *c, const char *name)
+{
+    Setting *s = NULL;
+
+    if (c->config.settings) {
+        s = g_hash_table_lookup(c->config.settings, name);
+    }
+
+    return s ? s : g_hash_table_lookup(global.settings, name);
+}
+
 VbCmdResult setting_run(Client *c, char *name, const char *param)
 {
     SettingType type = SETTING_SET;
@@ -204,7 +163,7 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
     }
 
     /* lookup a matching setting */
-    Setting *s = g_hash_table_lookup(c->config.settings, name);
+    Setting *s = setting_get(c, name);
     if (!s) {
         vb_echo(c, MSG_ERROR, TRUE, "Config '%s' not found", name);
         return CMD_ERROR | CMD_KEEPINPUT;
@@ -215,6 +174,12 @@ VbCmdResult setting_run(Client *c, char *name, const char *param)
         return CMD_SUCCESS | CMD_KEEPINPUT;
     }
 
+    /* settings set by the config file are shared with all clients, all
+     * other changes are local to the client */
+    if (!vb.in_config) {
+        s = setting_get_local(c, s);
+    }
+
     if (type == SETTING_TOGGLE) {
         if (s->type != TYPE_BOOLEAN) {
             vb_echo(c, MSG_ERROR, TRUE, "Could not toggle none boolean %s", s->name);
@@ -267,7 +232,7 @@ gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *inp
 {
     GtkTreeIter iter;
     gboolean found = FALSE;
-    GList *src     = g_hash_table_get_keys(c->config.settings);
+    GList *src     = g_hash_table_get_keys(global.settings);
 
     /* If no filter input given - copy all entries into the data store. */
     if (!input || !*input) {
@@ -297,12 +262,192 @@ gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *inp
 
 void setting_cleanup(Client *c)
 {
-    if (c->config.settings) {
-        g_hash_table_destroy(c->config.settings);
-        c->config.settings = NULL;
+    if (!c->config.settings) {
+        return;
+    }
+    g_hash_table_destroy(c->config.settings);
+    c->config.settings = NULL;
+
+    /* free the shared settings if the last client is gone */
+    if (--global.refcount == 0) {
+        g_slist_free(global.list);
+        g_hash_table_destroy(global.settings);
+        global.list     = NULL;
+        global.settings = NULL;
     }
 }
 
+/**
+ * Defines all the settings with their default values.
+ */
+static void setting_define(Client *c)
+{
+    int i;
+    gboolean on = TRUE, off = FALSE;
+
+    global.settings = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)setting_free);
+    setting_add(c, "user-agent", TYPE_CHAR, &"Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/11.0 Safari/605.1.15 " PROJECT "/" VERSION, webkit, 0, "user-agent");
+    /* TODO use the real names for webkit settings */
+    i = 14;
+    setting_add(c, "accelerated-2d-canvas", TYPE_BOOLEAN, &off, webkit, 0, "enable-accelerated-2d-canvas");
+    setting_add(c, "allow-file-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-file-access-from-file-urls");
+    setting_add(c, "allow-universal-access-from-file-urls", TYPE_BOOLEAN, &off, webkit, 0, "allow-universal-access-from-file-urls");
+    setting_add(c, "caret", TYPE_BOOLEAN, &off, webkit, 0, "enable-caret-browsing");
+    setting_add(c, "cursiv-font", TYPE_CHAR, &"serif", webkit, 0, "cursive-font-family");
+    setting_add(c, "default-charset", TYPE_CHAR, &"utf-8", webkit, 0, "default-charset");
+    setting_add(c, "default-font", TYPE_CHAR, &"sans-serif", webkit, 0, "default-font-family");
+    setting_add(c, "dns-prefetching", TYPE_BOOLEAN, &on, webkit, 0, "enable-dns-prefetching");
+    i = SETTING_DEFAULT_FONT_SIZE;
+    setting_add(c, "font-size", TYPE_INTEGER, &i, webkit, 0, "default-font-size");
+    setting_add(c, "frame-flattening", TYPE_BOOLEAN, &off, webkit, 0, "enable-frame-flattening");
+    setting_add(c, "hardware-acceleration-policy", TYPE_CHAR, &"ondemand", hardware_acceleration_policy, FLAG_NODUP, NULL);
+    setting_add(c, "header", TYPE_CHAR, &"", headers, FLAG_LIST|FLAG_NODUP, "header");
+    i = 1000;
+    setting_add(c, "hint-timeout", TYPE_INTEGER, &i, NULL, 0, NULL);
+    setting_add(c, "hint-keys", TYPE_CHAR, &"0123456789", NULL, 0, NULL);
+    setting_add(c, "hint-follow-last", TYPE_BOOLEAN, &on, NULL, 0, NULL);
+    setting_add(c, "hint-keys-same-length", TYPE_BOOLEAN, &off, NULL, 0, NULL);
+    setting_add(c, "html5-database", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-database");
+    setting_add(c, "html5-local-storage", TYPE_BOOLEAN, &on, webkit, 0, "enable-html5-local-storage");
+    setting_add(c, "hyperlink-auditing", TYPE_BOOLEAN, &off, webkit, 0, "enable-hyperlink-auditing");
+    setting_add(c, "images", TYPE_BOOLEAN, &on, webkit, 0, "auto-load-images");
+    setting_add(c, "javascript-can-access-clipboard", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-access-clipboard");
+    setting_add(c, "javascript-can-open-windows-automatically", TYPE_BOOLEAN, &off, webkit, 0, "javascript-can-open-windows-automatically");
+    setting_add(c, "media-playback-allows-inline", TYPE_BOOLEAN, &on, webkit, 0, "media-playback-allows-inline");
+    setting_add(c, "media-playback-requires-user-gesture", TYPE_BOOLEAN, &off, webkit, 0, "media-playback-requires-user-gesture");
+    setting_add(c, "media-stream", TYPE_BOOLEAN, &off, webkit, 0, "enable-media-stream");
+    setting_add(c, "mediasource", TYPE_BOOLEAN, &off, webkit, 0, "enable-mediasource");
+    i = 5;
+    setting_add(c, "minimum-font-size", TYPE_INTEGER, &i, webkit, 0, "minimum-font-size");
+    setting_add(c, "monospace-font", TYPE_CHAR, &"monospace", webkit, 0, "monospace-font-family");
+    i = SETTING_DEFAULT_MONOSPACE_FONT_SIZE;
+    setting_add(c, "monospace-font-size", TYPE_INTEGER, &i, webkit, 0, "default-monospace-font-size");
+    setting_add(c, "offline-cache", TYPE_BOOLEAN, &on, webkit, 0, "enable-offline-web-application-cache");
+    setting_add(c, "plugins", TYPE_BOOLEAN, &on, webkit, 0, "enable-plugins");
+    setting_add(c, "prevent-newwindow", TYPE_BOOLEAN, &off, internal, FLAG_CLIENT, CLIENT_FIELD(config.prevent_newwindow));
+    setting_add(c, "print-backgrounds", TYPE_BOOLEAN, &on, webkit, 0, "print-backgrounds");
+    setting_add(c, "sans-serif-font", TYPE_CHAR, &"sans-serif", webkit, 0, "sans-serif-font-family");
+    setting_add(c, "scripts", TYPE_BOOLEAN, &on, webkit, 0, "enable-javascript");
+    setting_add(c, "serif-font", TYPE_CHAR, &"serif", webkit, 0, "serif-font-family");
+    setting_add(c, "site-specific-quirks", TYPE_BOOLEAN, &off, webkit, 0, "enable-site-specific-quirks");
+    setting_add(c, "smooth-scrolling", TYPE_BOOLEAN, &off, webkit, 0, "enable-smooth-scrolling");
+    setting_add(c, "spacial-navigation", TYPE_BOOLEAN, &off, webkit, 0, "enable-spatial-navigation");
+    setting_add(c, "tabs-to-links", TYPE_BOOLEAN, &on, webkit, 0, "enable-tabs-to-links");
+    setting_add(c, "webaudio", TYPE_BOOLEAN, &off, webkit, 0, "enable-webaudio");
+    setting_add(c, "webgl", TYPE_BOOLEAN, &off, webkit, 0, "enable-webgl");
+    setting_add(c, "webinspector", TYPE_BOOLEAN, &on, webkit, 0, "enable-developer-extras");
+    setting_add(c, "xss-auditor", TYPE_BOOLEAN, &on, webkit, 0, "enable-xss-auditor");
+
+    /* internal variables */
+    setting_add(c, "stylesheet", TYPE_BOOLEAN, &on, user_style, 0, NULL);
+    setting_add(c, "user-scripts", TYPE_BOOLEAN, &on, user_scripts, 0, NULL);
+    setting_add(c, "cookie-accept", TYPE_CHAR, &"always", cookie_accept, 0, NULL);
+    i = 40;
+    setting_add(c, "scroll-step", TYPE_INTEGER, &i, internal, FLAG_CLIENT, CLIENT_FIELD(config.scrollstep));
+    setting_add(c, "home-page", TYPE_CHAR, &SETTING_HOME_PAGE, NULL, 0, NULL);
+    i = 2000;
+    /* TODO should be global and not overwritten by a new client */
+    setting_add(c, "history-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.history_max);
+    setting_add(c, "editor-command", TYPE_CHAR, &"x-terminal-emulator -e -vi '%s'", NULL, 0, NULL);
+    setting_add(c, "strict-ssl", TYPE_BOOLEAN, &on, tls_policy, 0, NULL);
+    setting_add(c, "status-bar", TYPE_BOOLEAN, &on, statusbar, 0, NULL);
+    i = 1000;
+    setting_add(c, "timeoutlen", TYPE_INTEGER, &i, internal, FLAG_CLIENT, CLIENT_FIELD(map.timeoutlen));
+    setting_add(c, "input-autohide", TYPE_BOOLEAN, &off, input_autohide, FLAG_CLIENT, CLIENT_FIELD(config.input_autohide));
+    setting_add(c, "fullscreen", TYPE_BOOLEAN, &off, fullscreen, 0, NULL);
+    setting_add(c, "show-titlebar", TYPE_BOOLEAN, &on, window_decorate, 0, NULL);
+    i = 100;
+    setting_add(c, "default-zoom", TYPE_INTEGER, &i, default_zoom, 0, NULL);
+    setting_add(c, "download-path", TYPE_CHAR, &"~/", NULL, 0, NULL);
+    setting_add(c, "download-command", TYPE_CHAR, &"/bin/sh -c \"curl -sLJOC - -e '$VIMB_URI' %s\"", NULL, 0, NULL);
+    setting_add(c, "download-use-external", TYPE_BOOLEAN, &off, NULL, 0, NULL);
+    setting_add(c, "incsearch", TYPE_BOOLEAN, &off, internal, FLAG_CLIENT, CLIENT_FIELD(config.incsearch));
+    i = 10;
+    /* TODO should be global and not overwritten by a new client */
+    setting_add(c, "closed-max-items", TYPE_INTEGER, &i, internal, 0, &vb.config.closed_max);
+    setting_add(c, "x-hint-command", TYPE_CHAR, &":o <C-R>;", NULL, 0, NULL);
+    setting_add(c, "spell-checking", TYPE_BOOLEAN, &off, webkit_spell_checking, 0, NULL);
+    setting_add(c, "spell-checking-languages", TYPE_CHAR, &"en_US", webkit_spell_checking_language, FLAG_LIST|FLAG_NODUP, NULL);
+
+    /* gui style settings vimb */
+    setting_add(c, "completion-css", TYPE_CHAR, &"color:#fff;background-color:#656565;font:" SETTING_GUI_FONT_NORMAL, gui_style, 0, NULL);
+    setting_add(c, "completion-hover-css", TYPE_CHAR, &"background-color:#777;", gui_style, 0, NULL);
+    setting_add(c, "completion-selected-css", TYPE_CHAR, &"color:#f6f3e8;background-color:#888;", gui_style, 0, NULL);
+    setting_add(c, "input-css", TYPE_CHAR, &"background-color:#fff;color:#000;font:" SETTING_GUI_FONT_NORMAL, gui_style, 0, NULL);
+    setting_add(c, "input-error-css", TYPE_CHAR, &"background-color:#f77;font:" SETTING_GUI_FONT_EMPH, gui_style, 0, NULL);
+    setting_add(c, "status-css", TYPE_CHAR, &"color:#fff;background-color:#000;font:" SETTING_GUI_FONT_EMPH, gui_style, 0, NULL);
+    setting_add(c, "status-ssl-css", TYPE_CHAR, &"background-color:#95e454;color:#000;", gui_style, 0, NULL);
+    setting_add(c, "status-ssl-invalid-css", TYPE_CHAR, &"background-color:#f77;color:#000;", gui_style, 0, NULL);
+
+    /* keep the settings in the order of their definition */
+    global.list = g_slist_reverse(global.list);
+}
+
+/**
+ * Apply the current value of given setting to the client.
+ */
+static void setting_apply(Client *c, Setting *prop)
+{
+    void *value;
+
+    if (!prop->setter) {
+        return;
+    }
+
+    switch (prop->type) {
+        case TYPE_BOOLEAN:
+            value = &prop->value.b;
+            break;
+
+        case TYPE_INTEGER:
+            value = &prop->value.i;
+            break;
+
+        default:
+            value = prop->value.s;
+            break;
+    }
+    prop->setter(c, prop->name, prop->type, value, setting_data(c, prop));
+}
+
+/**
+ * Returns the clients own copy of the setting. The copy is created from the
+ * global setting if the client did not change the setting before.
+ */
+static Setting *setting_get_local(Client *c, Setting *prop)
+{
+    Setting *local = g_hash_table_lookup(c->config.settings, prop->name);
+
+    if (!local) {
+        local = g_slice_dup(Setting, prop);
+        if (prop->type == TYPE_CHAR || prop->type == TYPE_COLOR || prop->type == TYPE_FONT) {
+            local->value.s = g_strdup(prop->value.s);
+        }
+        g_hash_table_insert(c->config.settings, (char*)local->name, local);
+    }
+
+    return local;
+}
+
+/**
+ * Returns the data given to the setter of the setting.
+ */
+static void *setting_data(Client *c, Setting *prop)
+{
+    if (prop->flags & FLAG_CLIENT) {
+        return G_STRUCT_MEMBER_P(c, GPOINTER_TO_SIZE(prop->data));
+    }
+    return prop->data;
+}
+
+/**
+ * Returns the WebKitSettings the webkit settings of the client are applied to.
+ */
+static WebKitSettings *get_web_settings(Client *c)
+{
+    return batch ? batch : webkit_web_view_get_settings(c->webview);
+}
+
 static int setting_set_value(Client *c, Setting *prop, void *value, SettingType type)
 {
     int res = CMD_SUCCESS;
@@ -316,7 +461,7 @@ static int setting_set_value(Client *c, Setting *prop, void *value, SettingType
     /* if there is a setter defined - call this first to check if the value is
      * accepted */
     if (prop->setter) {
-        res = prop->setter(c, prop->name, prop->type, newvalue, prop->data);
+        res = prop->setter(c, prop->name, prop->type, newvalue, setting_data(c, prop));
         /* break here on error and don't change the setting */
         if (res & CMD_ERROR) {
             goto free;
@@ -464,7 +609,8 @@ static gboolean setting_add(Client *c, const char *name, DataType type, void *va
 
     setting_set_value(c, prop, value, SETTING_SET);
 
-    g_hash_table_insert(c->config.settings, (char*)name, prop);
+    g_hash_table_insert(global.settings, (char*)name, prop);
+    global.list = g_slist_prepend(global.list, prop);
     return TRUE;
 }
 
@@ -522,7 +668,7 @@ static int default_zoom(Client *c, const char *name, DataType type, void *value,
     c->config.default_zoom = *(int*)value;
 
     /* Apply the default zoom to the webview. */
-    webkit_settings_set_zoom_text_only(webkit_web_view_get_settings(c->webview), FALSE);
+    webkit_settings_set_zoom_text_only(get_web_settings(c), FALSE);
     webkit_web_view_set_zoom_level(c->webview, c->config.default_zoom / 100.0);
 
     return CMD_SUCCESS;
@@ -552,7 +698,7 @@ static int window_decorate(Client *c, const char *name, DataType type, void *val
 
 static int hardware_acceleration_policy(Client *c, const char *name, DataType type, void *value, void *data)
 {
-    WebKitSettings *settings = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *settings = get_web_settings(c);
 
     if (g_str_equal(value, "ondemand")) {
         webkit_settings_set_hardware_acceleration_policy(settings, WEBKIT_HARDWARE_ACCELERATION_POLICY_ON_DEMAND);
@@ -571,12 +717,13 @@ static int hardware_acceleration_policy(Client *c, const char *name, DataType ty
 /**
  * Allow to set user defined http headers.
  *
- * :set header=NAME1=VALUE!,NAME2=,NAME3
+ * :set header=NAME1=VALUE!,NAME2=,NAME3,example.org/NAME4=VALUE
  *
  * Note that these headers will replace already existing headers. If there is
  * no '=' after the header name, than the complete header will be removed from
  * the request (NAME3), if the '=' is present means that the header value is
- * set to empty value.
+ * set to empty value. A header prefixed with a domain and '/' is only changed
+ * on requests to this domain and its subdomains (NAME4).
  */
 static int headers(Client *c, const char *name, DataType type, void *value, void *data)
 {
@@ -654,7 +801,7 @@ static int user_scripts(Client *c, const char *name, DataType type, void *value,
     }
 
     /* Inject the global scripts. */
-    script = webkit_user_script_new(JS_HINTS " " JS_SCROLL,
+    script = webkit_user_script_new(JS_SCROLL,
             WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
             WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END, NULL, NULL);
     webkit_user_content_manager_add_script(ucm, script);
@@ -729,7 +876,7 @@ static int tls_policy(Client *c, const char *name, DataType type, void *value, v
 static int webkit(Client *c, const char *name, DataType type, void *value, void *data)
 {
     const char *property = (const char*)data;
-    WebKitSettings *web_setting = webkit_web_view_get_settings(c->webview);
+    WebKitSettings *web_setting = get_web_settings(c);
 
     switch (type) {
         case TYPE_BOOLEAN:
@@ -26,6 +26,7 @@
 
 void setting_init(Client *c);
 void setting_cleanup(Client *c);
+Setting *setting_get(Client *c, const char *name);
 VbCmdResult setting_run(Client *c, char *name, const char *param);
 gboolean setting_fill_completion(Client *c, GtkListStore *store, const char *input);
 
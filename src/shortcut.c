@@ -30,20 +30,57 @@ struct shortcut {
     char        *fallback;  /* default shortcut to use if none given in request */
 };
 
+/* Literal text of the uri template followed by a placeholder. */
+typedef struct {
+    int offset;     /* start of the literal text in the template */
+    int len;        /* length of the literal text */
+    int slot;       /* number of the placeholder after the text or -1 */
+} Part;
+
+typedef struct {
+    char  *uri;     /* the uri template */
+    int   max;      /* highest placeholder number or -1 if there is none */
+    int   count;    /* number of parts */
+    Part  *parts;
+} Template;
+
 extern struct Vimb vb;
 
-static int get_max_placeholder(const char *str);
-static const char *shortcut_lookup(Shortcut *sc, const char *string, const char **query);
+static Template *template_new(const char *uri);
+static void template_free(Template *tmpl);
+static int parse_query(const char *query, int max, const char **token, int *len);
+static void append_encoded(GString *str, const char *token, int len);
+static Template *shortcut_lookup(Shortcut *sc, const char *string, const char **query);
 
 Shortcut *shortcut_new(void)
 {
     Shortcut *sc = g_new(Shortcut, 1);
-    sc->table    = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    sc->table    = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)template_free);
     sc->fallback = NULL;
 
     return sc;
 }
 
+/**
+ * Creates a new shortcut table with the shortcuts of given one.
+ */
+Shortcut *shortcut_copy(Shortcut *sc)
+{
+    GHashTableIter iter;
+    char *key;
+    Template *tmpl;
+    Shortcut *copy = shortcut_new();
+
+    g_hash_table_iter_init(&iter, sc->table);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&key, (gpointer*)&tmpl)) {
+        shortcut_add(copy, key, tmpl->uri);
+    }
+    copy->fallback = g_strdup(sc->fallback);
+
+    return copy;
+}
+
 void shortcut_free(Shortcut *sc)
 {
     if (sc->table) {
@@ -54,7 +91,7 @@ void shortcut_free(Shortcut *sc)
 
 gboolean shortcut_add(Shortcut *sc, const char *key, const char *uri)
 {
-    g_hash_table_insert(sc->table, g_strdup(key), g_strdup(uri));
+    g_hash_table_insert(sc->table, g_strdup(key), template_new(uri));
 
     return TRUE;
 }
@@ -79,48 +116,132 @@ gboolean shortcut_set_default(Shortcut *sc, const char *key)
  */
 char *shortcut_get_uri(Shortcut *sc, const char *string)
 {
-    const char *tmpl, *query = NULL;
-    char *uri, *quoted_param;
-    int max_num, current_num;
-    GString *token;
+    const char *query = NULL, *token[10];
+    int i, count, len[10];
+    Template *tmpl;
+    GString *uri;
+    Part *part;
 
     tmpl = shortcut_lookup(sc, string, &query);
     if (!tmpl) {
         return NULL;
     }
 
-    max_num = get_max_placeholder(tmpl);
+    /* skip if no placeholders found */
+    if (tmpl->max < 0) {
+        return g_strdup(tmpl->uri);
+    }
+
+    if (!query) {
+        query = "";
+    }
     /* if there are only $0 placeholders we don't need to split the parameters */
-    if (max_num == 0) {
-        quoted_param = soup_uri_encode(query, "&+");
-        uri          = util_str_replace("$0", quoted_param, tmpl);
-        g_free(quoted_param);
+    if (tmpl->max == 0) {
+        token[0] = query;
+        len[0]   = strlen(query);
+        count    = 1;
+    } else {
+        count = parse_query(query, tmpl->max, token, len);
+    }
 
-        return uri;
+    uri = g_string_sized_new(strlen(tmpl->uri) + strlen(query) * 3);
+    for (i = 0; i < tmpl->count; i++) {
+        part = &tmpl->parts[i];
+        g_string_append_len(uri, tmpl->uri + part->offset, part->len);
+        if (part->slot < 0) {
+            continue;
+        }
+        /* don't remove non matched placeholders */
+        if (part->slot >= count || (tmpl->max && !len[part->slot])) {
+            g_string_append_c(uri, '$');
+            g_string_append_c(uri, part->slot + '0');
+        } else {
+            append_encoded(uri, token[part->slot], len[part->slot]);
+        }
     }
 
-    uri = g_strdup(tmpl);
+    return g_string_free(uri, FALSE);
+}
 
-    /* skip if no placeholders found */
-    if (max_num < 0) {
-        return uri;
+gboolean shortcut_fill_completion(Shortcut *sc, GtkListStore *store, const char *input)
+{
+    GList *src = g_hash_table_get_keys(sc->table);
+    gboolean found = util_fill_completion(store, input, src);
+    g_list_free(src);
+
+    return found;
+}
+
+/**
+ * Compiles the uri template into the literal parts and the placeholders $0 to
+ * $9 between them.
+ */
+static Template *template_new(const char *uri)
+{
+    Template *tmpl = g_slice_new(Template);
+    const char *p, *start;
+    GArray *parts = g_array_new(FALSE, FALSE, sizeof(Part));
+    Part part;
+
+    tmpl->uri = g_strdup(uri);
+    tmpl->max = -1;
+    for (p = start = tmpl->uri; *p; p++) {
+        if (*p == '$' && VB_IS_DIGIT(p[1])) {
+            part.offset = start - tmpl->uri;
+            part.len    = p - start;
+            part.slot   = p[1] - '0';
+            g_array_append_val(parts, part);
+
+            if (part.slot > tmpl->max) {
+                tmpl->max = part.slot;
+            }
+            start = ++p + 1;
+        }
     }
+    /* the trailing text without placeholder */
+    part.offset = start - tmpl->uri;
+    part.len    = p - start;
+    part.slot   = -1;
+    g_array_append_val(parts, part);
 
-    current_num = 0;
-    token       = g_string_new(NULL);
-    while (*query) {
+    tmpl->count = parts->len;
+    tmpl->parts = (Part*)g_array_free(parts, FALSE);
+
+    return tmpl;
+}
+
+static void template_free(Template *tmpl)
+{
+    g_free(tmpl->uri);
+    g_free(tmpl->parts);
+    g_slice_free(Template, tmpl);
+}
+
+/**
+ * Splits the query into the parameters for the placeholders $0 to $max and
+ * returns the number of parsed parameters. The parameters are separated by
+ * whitespace or quoted, the last one takes the rest of the query. Start and
+ * length of the parameters are written to token and len.
+ */
+static int parse_query(const char *query, int max, const char **token, int *len)
+{
+    int num = 0;
+    const char *start;
+
+    while (*query && num <= max) {
         /* parse the query tokens */
         if (*query == '"' || *query == '\'') {
             /* save the last used quote char to find it's matching counterpart */
             char last_quote = *query;
 
             /* skip the quote */
-            query++;
+            start = ++query;
             /* collect the char until the closing quote or end of string */
             while (*query && *query != last_quote) {
-                g_string_append_c(token, *query);
                 query++;
             }
+            token[num] = start;
+            len[num]   = query - start;
             /* if we end up at the closing quote - skip this quote too */
             if (*query == last_quote) {
                 query++;
@@ -130,68 +251,43 @@ char *shortcut_get_uri(Shortcut *sc, const char *string)
             query++;
 
             continue;
-        } else if (current_num >= max_num) {
+        } else if (num >= max) {
             /* if we have parsed as many params like placeholders - put the
              * rest of the query as last parameter */
-            while (*query) {
-                g_string_append_c(token, *query);
-                query++;
-            }
+            token[num] = query;
+            len[num]   = strlen(query);
+            query     += len[num];
         } else {
             /* collect the following character up to the next whitespace */
-            while (*query && !VB_IS_SPACE(*query)) {
-                g_string_append_c(token, *query);
-                query++;
-            }
+            for (start = query; *query && !VB_IS_SPACE(*query); query++);
+            token[num] = start;
+            len[num]   = query - start;
         }
-
-        /* replace the placeholders with parsed token */
-        if (token->len) {
-            char *new;
-
-            quoted_param = soup_uri_encode(token->str, "&+");
-            new = util_str_replace((char[]){'$', current_num + '0', '\0'}, quoted_param, uri);
-            g_free(quoted_param);
-            g_free(uri);
-            uri = new;
-
-            /* truncate the last token to fill for next loop */
-            g_string_truncate(token, 0);
-        }
-        current_num++;
+        num++;
     }
-    g_string_free(token, TRUE);
-
-    return uri;
-}
-
-gboolean shortcut_fill_completion(Shortcut *sc, GtkListStore *store, const char *input)
-{
-    GList *src = g_hash_table_get_keys(sc->table);
-    gboolean found = util_fill_completion(store, input, src);
-    g_list_free(src);
 
-    return found;
+    return num;
 }
 
 /**
- * Retrieves th highest placeholder number used in given string.
- * If no placeholder is found -1 is returned.
+ * Appends the token URI-encoded like soup_uri_encode(token, "&+") does.
  */
-static int get_max_placeholder(const char *str)
+static void append_encoded(GString *str, const char *token, int len)
 {
-    int n, res;
-
-    for (n = 0, res = -1; *str; str++) {
-        if (*str == '$') {
-            n = *(++str) - '0';
-            if (0 <= n && n <= 9 && n > res) {
-                res = n;
-            }
+    static const char hex[] = "0123456789ABCDEF";
+    const char *end;
+
+    for (end = token + len; token < end; token++) {
+        if (soup_char_is_uri_percent_encoded(*token)
+                || soup_char_is_uri_gen_delims(*token)
+                || *token == '&' || *token == '+') {
+            g_string_append_c(str, '%');
+            g_string_append_c(str, hex[(guchar)*token >> 4]);
+            g_string_append_c(str, hex[(guchar)*token & 0xf]);
+        } else {
+            g_string_append_c(str, *token);
         }
     }
-
-    return res;
 }
 
 /**
@@ -199,9 +295,10 @@ static int get_max_placeholder(const char *str)
  * pointer with the query part of the given string (everything except of the
  * shortcut identifier).
  */
-static const char *shortcut_lookup(Shortcut *sc, const char *string, const char **query)
+static Template *shortcut_lookup(Shortcut *sc, const char *string, const char **query)
 {
-    char *p, *uri = NULL;
+    char *p;
+    Template *uri = NULL;
 
     if ((p = strchr(string, ' '))) {
         char *key  = g_strndup(string, p - string);
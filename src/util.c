@@ -39,9 +39,38 @@ static struct {
 
 extern struct Vimb vb;
 
+/* Instructions of a compiled pattern. */
+enum {
+    PAT_CHAR,   /* matches the char c */
+    PAT_ANY,    /* matches any char except of '/' */
+    PAT_STAR,   /* matches any sequence of chars */
+    PAT_SPLIT,  /* continues at x and at y */
+    PAT_JMP,    /* continues at x */
+    PAT_MATCH,  /* the pattern matches if the subject ended here */
+};
+
+typedef struct {
+    char op;
+    char c;
+    int  x, y;
+} PatInst;
+
+struct pattern {
+    PatInst *inst;
+    int     len;
+    int     size;
+    /* working space of the matcher to avoid allocations on each match */
+    int     *clist;
+    int     *nlist;
+    guint   *mark;  /* generation an instruction was last added to a list */
+    guint   gen;
+};
+
 static void create_dir_if_not_exists(const char *dirpath);
-static gboolean match(const char *pattern, int patlen, const char *subject);
-static gboolean match_list(const char *pattern, int patlen, const char *subject);
+static gboolean pattern_compile(Pattern *p, const char *start, const char *end);
+static int pattern_emit(Pattern *p, char op, char c);
+static void pattern_add(Pattern *p, int *list, int *len, int pc);
+static void pattern_next_gen(Pattern *p);
 
 /**
  * Build the absolute file path of given path and possible given directory.
@@ -919,194 +948,311 @@ static void create_dir_if_not_exists(const char *dirpath)
  *           escaped by '\'. '*' and '?' have no special meaning within the
  *           curly braces.
  * *?{}      these chars must always be escaped by '\' to match them literally
+ *
+ * All other chars are compared case insensitive. To match the same pattern
+ * against many subjects use util_pattern_new() instead.
  */
 gboolean util_wildmatch(const char *pattern, const char *subject)
 {
+    gboolean result;
+    Pattern *p = util_pattern_new(pattern);
+
+    result = util_pattern_match(p, subject);
+    util_pattern_free(p);
+
+    return result;
+}
+
+/**
+ * Compiles the given list of patterns into a matcher that can be run against
+ * many subjects without parsing the pattern again. The patterns have the same
+ * syntax and meaning like for util_wildmatch().
+ *
+ * Returned matcher must be freed by util_pattern_free().
+ */
+Pattern *util_pattern_new(const char *pattern)
+{
+    Pattern *p;
     const char *end;
-    int braces, patlen, count;
-
-    /* loop through all pattens */
-    for (count = 0; *pattern; pattern = (*end == ',' ? end + 1 : end), count++) {
-        /* find end of the pattern - but be careful with comma in curly braces */
-        braces = 0;
-        for (end = pattern; *end && (*end != ',' || braces || *(end - 1) == '\\'); ++end) {
-            if (*end == '{') {
-                braces++;
+    gboolean inlist;
+    int start, split, lastsplit = 0, jumps = -1, next;
+
+    p = g_slice_new0(Pattern);
+    do {
+        /* find end of the pattern - but be careful with comma in curly
+         * braces and escaped commas */
+        for (end = pattern, inlist = false; *end && (*end != ',' || inlist); end++) {
+            if (*end == '\\' && end[1] && strchr(inlist ? ",{}" : "*?{},", end[1])) {
+                end++;
+            } else if (*end == '{') {
+                inlist = true;
             } else if (*end == '}') {
-                braces--;
+                inlist = false;
             }
         }
-        /* ignore single comma */
-        if (*pattern == *end) {
+        /* ignore single comma - but the empty pattern matches the empty
+         * subject */
+        if (end == pattern && *end) {
+            pattern = *end ? end + 1 : end;
             continue;
         }
-        /* calculate the length of the pattern */
-        patlen = end - pattern;
 
-        /* if this pattern matches - return */
-        if (match(pattern, patlen, subject)) {
-            return true;
+        start = p->len;
+        split = pattern_emit(p, PAT_SPLIT, 0);
+        if (pattern_compile(p, pattern, end)) {
+            next             = pattern_emit(p, PAT_JMP, 0);
+            p->inst[next].x  = jumps;  /* chain the jumps to patch them later */
+            jumps            = next;
+            p->inst[split].x = split + 1;
+            p->inst[split].y = p->len;
+            lastsplit        = split;
+        } else {
+            /* patterns that can never match are dropped */
+            p->len = start;
+        }
+        pattern = *end ? end + 1 : end;
+    } while (*pattern);
+
+    if (jumps >= 0) {
+        /* the last alternative does not need a split */
+        p->inst[lastsplit].op = PAT_JMP;
+        p->inst[lastsplit].x  = lastsplit + 1;
+        for (; jumps >= 0; jumps = next) {
+            next               = p->inst[jumps].x;
+            p->inst[jumps].x   = p->len;
+        }
+        pattern_emit(p, PAT_MATCH, 0);
+    }
+
+    p->clist = g_new(int, p->len + 1);
+    p->nlist = g_new(int, p->len + 1);
+    p->mark  = g_new0(guint, p->len + 1);
+
+    return p;
+}
+
+/**
+ * Checks if the given subject matches the compiled pattern.
+ *
+ * The matcher runs all the possible positions in the pattern in parallel, so
+ * the time is linear to the length of the subject, also for patterns with
+ * many '*'.
+ */
+gboolean util_pattern_match(Pattern *p, const char *subject)
+{
+    int *clist, *nlist, *tmp, clen, nlen, i, pc;
+    char c;
+
+    if (!p->len) {
+        return false;
+    }
+
+    clist = p->clist;
+    nlist = p->nlist;
+    clen  = 0;
+    pattern_next_gen(p);
+    pattern_add(p, clist, &clen, 0);
+
+    for (; *subject && clen; subject++) {
+        c = *subject;
+        if (VB_IS_UPPER(c)) {
+            c += 'a' - 'A';
         }
+        nlen = 0;
+        pattern_next_gen(p);
+        for (i = 0; i < clen; i++) {
+            pc = clist[i];
+            switch (p->inst[pc].op) {
+                case PAT_STAR:
+                    /* a trailing '*' matches the rest of the subject */
+                    if (p->inst[pc + 1].op == PAT_MATCH) {
+                        return true;
+                    }
+                    pattern_add(p, nlist, &nlen, pc);
+                    break;
+
+                case PAT_ANY:
+                    if (c != '/') {
+                        pattern_add(p, nlist, &nlen, pc + 1);
+                    }
+                    break;
+
+                case PAT_CHAR:
+                    if (c == p->inst[pc].c) {
+                        pattern_add(p, nlist, &nlen, pc + 1);
+                    }
+                    break;
+            }
+        }
+        tmp   = clist;
+        clist = nlist;
+        nlist = tmp;
+        clen  = nlen;
     }
 
-    if (!count) {
-        /* empty pattern matches only on empty subject */
-        return !*subject;
+    /* on end of pattern only a also ended subject is a match */
+    for (i = 0; i < clen; i++) {
+        if (p->inst[clist[i]].op == PAT_MATCH) {
+            return true;
+        }
     }
-    /* there where one or more patterns but none of them matched */
     return false;
 }
 
+void util_pattern_free(Pattern *p)
+{
+    if (p) {
+        g_free(p->inst);
+        g_free(p->clist);
+        g_free(p->nlist);
+        g_free(p->mark);
+        g_slice_free(Pattern, p);
+    }
+}
+
 
 /**
- * Compares given subject string against the given pattern.
- * The pattern needs not to bee NUL terminated.
+ * Compiles a single pattern between start and end and appends the
+ * instructions to the matcher. Returns false if the pattern can never match
+ * because of spurious '}' or unterminated '{'.
  */
-static gboolean match(const char *pattern, int patlen, const char *subject)
+static gboolean pattern_compile(Pattern *p, const char *start, const char *end)
 {
-    int i;
-    char sl, pl;
+    const char *s, *close;
+    int split, jumps, next;
 
-    while (patlen > 0) {
-        switch (*pattern) {
-            case '?':
-                /* '?' matches a single char except of / and subject end */
-                if (*subject == '/' || !*subject) {
-                    return false;
+    for (s = start; s < end; s++) {
+        switch (*s) {
+            case '*':
+                /* multiple '*' behave like a single one */
+                if (s == start || s[-1] != '*') {
+                    pattern_emit(p, PAT_STAR, 0);
                 }
                 break;
 
-            case '*':
-                /* easiest case - the '*' ist the last char in pattern - this
-                 * will always match */
-                if (patlen == 1) {
-                    return true;
-                }
-                /* Try to match as much as possible. Try to match the complete
-                 * uri, if that fails move forward in uri and check for a
-                 * match. */
-                i = strlen(subject);
-                while (i >= 0 && !match(pattern + 1, patlen - 1, subject + i)) {
-                    i--;
-                }
-                return i >= 0;
+            case '?':
+                pattern_emit(p, PAT_ANY, 0);
+                break;
 
             case '}':
                 /* spurious '}' in pattern */
                 return false;
 
             case '{':
-                /* possible {foo,bar} pattern */
-                return match_list(pattern, patlen, subject);
+                /* find the next none escaped '}' */
+                for (close = s + 1; close < end && *close != '}'; close++) {
+                    if (*close == '\\' && close + 1 < end && strchr(",{}", close[1])) {
+                        close++;
+                    }
+                }
+                if (close >= end) {
+                    /* unterminated '{' in pattern */
+                    return false;
+                }
+                /* each item of the list becomes an alternative that continues
+                 * after the closing '}' */
+                for (jumps = -1, s++; ; s++) {
+                    split = pattern_emit(p, PAT_SPLIT, 0);
+                    for (; s < close && *s != ','; s++) {
+                        if (*s == '\\' && s + 1 < close && strchr(",{}", s[1])) {
+                            s++;
+                        }
+                        pattern_emit(p, PAT_CHAR, *s);
+                    }
+                    next             = pattern_emit(p, PAT_JMP, 0);
+                    p->inst[next].x  = jumps;
+                    jumps            = next;
+                    p->inst[split].x = split + 1;
+                    p->inst[split].y = p->len;
+                    if (s >= close) {
+                        p->inst[split].op = PAT_JMP;
+                        break;
+                    }
+                }
+                for (; jumps >= 0; jumps = next) {
+                    next             = p->inst[jumps].x;
+                    p->inst[jumps].x = p->len;
+                }
+                break;
 
             case '\\':
                 /* '\' escapes next special char */
-                if (strchr("*?{}", pattern[1])) {
-                    pattern++;
-                    patlen--;
-                    if (*pattern != *subject) {
-                        return false;
-                    }
+                if (s + 1 < end && strchr("*?{},", s[1])) {
+                    s++;
                 }
-                break;
+                /* fall through */
 
             default:
-                /* compare case insensitive */
-                sl = *subject;
-                if (VB_IS_UPPER(sl)) {
-                    sl += 'a' - 'A';
-                }
-                pl = *pattern;
-                if (VB_IS_UPPER(pl)) {
-                    pl += 'a' - 'A';
-                }
-                if (sl != pl) {
-                    return false;
-                }
+                pattern_emit(p, PAT_CHAR, *s);
                 break;
         }
-        /* do another loop run with next pattern and subject char */
-        pattern++;
-        patlen--;
-        subject++;
     }
 
-    /* on end of pattern only a also ended subject is a match */
-    return !*subject;
+    return true;
 }
 
 /**
- * Matches pattern starting with '{'.
- * This function can process also on none null terminated pattern.
+ * Appends a new instruction to the compiled pattern and returns the index of
+ * it.
  */
-static gboolean match_list(const char *pattern, int patlen, const char *subject)
+static int pattern_emit(Pattern *p, char op, char c)
 {
-    int endlen;
-    const char *end, *s;
-
-    /* finde the next none escaped '}' */
-    for (end = pattern, endlen = patlen; endlen > 0 && *end != '}'; end++, endlen--) {
-        /* if escape char - move pointer one additional step */
-        if (*end == '\\') {
-            end++;
-            endlen--;
-        }
+    if (p->len == p->size) {
+        p->size = p->size ? p->size * 2 : 16;
+        p->inst = g_renew(PatInst, p->inst, p->size);
     }
-
-    if (!*end) {
-        /* unterminated '{' in pattern */
-        return false;
+    if (VB_IS_UPPER(c)) {
+        c += 'a' - 'A';
     }
+    p->inst[p->len].op = op;
+    p->inst[p->len].c  = c;
+    p->inst[p->len].x  = 0;
+    p->inst[p->len].y  = 0;
 
-    s = subject;
-    end++;      /* skip over } */
-    endlen--;
-    pattern++;  /* skip over { */
-    patlen--;
-    while (true) {
-        switch (*pattern) {
-            case ',':
-                if (match(end, endlen, s)) {
-                    return true;
-                }
-                s = subject;
-                pattern++;
-                patlen--;
-                break;
-
-            case '}':
-                return match(end, endlen, s);
-
-            case '\\':
-                if (pattern[1] == ',' || pattern[1] == '}' || pattern[1] == '{') {
-                    pattern++;
-                    patlen--;
-                }
-                /* fall through */
+    return p->len++;
+}
 
-            default:
-                if (*pattern == *s) {
-                    pattern++;
-                    patlen--;
-                    s++;
-                } else {
-                    /* this item of the list does not match - move forward to
-                     * the next none escaped ',' or '}' */
-                    s = subject;
-                    for (s = subject; *pattern != ',' && *pattern != '}'; pattern++, patlen--) {
-                        /* if escape char is found - skip next char */
-                        if (*pattern == '\\') {
-                            pattern++;
-                            patlen--;
-                        }
-                    }
-                    /* found ',' skip over it to check the next list item */
-                    if (*pattern == ',') {
-                        pattern++;
-                        patlen--;
-                    }
-                }
-        }
+/**
+ * Adds the instruction and all the instructions reachable from it without
+ * consuming a char to the list of positions.
+ */
+static void pattern_add(Pattern *p, int *list, int *len, int pc)
+{
+    if (p->mark[pc] == p->gen) {
+        return;
+    }
+    p->mark[pc] = p->gen;
+
+    switch (p->inst[pc].op) {
+        case PAT_JMP:
+            pattern_add(p, list, len, p->inst[pc].x);
+            break;
+
+        case PAT_SPLIT:
+            pattern_add(p, list, len, p->inst[pc].x);
+            pattern_add(p, list, len, p->inst[pc].y);
+            break;
+
+        case PAT_STAR:
+            /* '*' might also match the empty string */
+            list[(*len)++] = pc;
+            pattern_add(p, list, len, pc + 1);
+            break;
+
+        default:
+            list[(*len)++] = pc;
+            break;
     }
 }
 
+/**
+ * Starts a new list of positions so that each instruction can be added once
+ * again.
+ */
+static void pattern_next_gen(Pattern *p)
+{
+    if (!++p->gen) {
+        memset(p->mark, 0, sizeof(guint) * (p->len + 1));
+        p->gen = 1;
+    }
+}
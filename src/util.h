@@ -29,6 +29,7 @@ enum {
     UTIL_EXP_SPECIAL = 0x04, /* expand % to current URI */
 };
 typedef void *(*Util_Content_Func)(const char*, const char*);
+typedef struct pattern Pattern;
 
 char *util_build_path(State state, const char *path, const char *dir);
 void util_cleanup(void);
@@ -52,6 +53,9 @@ char *util_js_result_as_string(WebKitJavascriptResult *result);
 double util_js_result_as_number(WebKitJavascriptResult *result);
 gboolean util_parse_expansion(State state, const char **input, GString *str,
         int flags, const char *quoteable);
+Pattern *util_pattern_new(const char *pattern);
+gboolean util_pattern_match(Pattern *p, const char *subject);
+void util_pattern_free(Pattern *p);
 char *util_sanitize_filename(char *filename);
 char *util_sanitize_uri(const char *uri_str);
 char *util_strcasestr(const char *haystack, const char *needle);
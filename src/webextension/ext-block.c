@@ -0,0 +1,547 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* Blocking of requests by host lists and a subset of the EasyList filter
+ * syntax. Blocked domains are kept in a hash table which is checked for the
+ * request host and its parent domains. The other filters are indexed by the
+ * longest literal part of their pattern, the keyword. All keywords are
+ * searched in one pass over the uri by a keyword set and only the filters of
+ * found keywords are checked against the uri around the found keyword. */
+
+#include <glib.h>
+#include <string.h>
+
+#include "../keyword-set.h"
+#include "ext-block.h"
+
+/* Minimum length of the keyword of a filter. Filters with shorter literal
+ * parts would be checked for nearly every uri and are ignored. */
+#define MIN_KEYWORD_LEN 3
+
+enum {
+    RULE_ANCHOR_START = 1 << 0,     /* |pattern */
+    RULE_ANCHOR_END   = 1 << 1,     /* pattern| */
+    RULE_ANCHOR_HOST  = 1 << 2,     /* ||pattern */
+};
+
+/* A filter that is checked if its keyword was found in the uri. */
+typedef struct {
+    char  *pattern;     /* lower case pattern with '*' and '^' */
+    gsize len;          /* length of the pattern */
+    gsize keyword;      /* offset of the keyword within the pattern */
+    gsize keyword_len;
+    guint flags;
+} Rule;
+
+/* The uri a search of the keyword sets is done for. */
+typedef struct {
+    const char *uri;
+    gsize      len;
+    const char *host;
+    const char *host_end;
+} Request;
+
+struct Blocker {
+    GHashTable *hosts;          /* blocked domains */
+    GHashTable *allowed_hosts;  /* domains of @@||domain^ exceptions */
+    KeywordSet *block;
+    KeywordSet *allow;
+    GPtrArray  *rules;          /* rules of both keyword sets */
+    guint      count;           /* number of used filters and hosts */
+};
+
+static void parse_line(Blocker *b, char *line);
+static void add_host(GHashTable *hosts, const char *host, guint *count);
+static gboolean is_domain(const char *str, gsize len);
+static gboolean host_in(GHashTable *hosts, const char *host);
+static gboolean get_host(const char *uri, const char **start, const char **end);
+static void add_rule(Blocker *b, gboolean allow, const char *keyword,
+        gsize len, const char *pattern, guint flags);
+static gboolean matches(KeywordSet *set, Request *req);
+static void rule_free(Rule *rule);
+static gboolean rule_matches(Rule *rule, gsize end, Request *req);
+static gboolean match_glob(const char *pattern, gsize len, const char *s,
+        const char *end, gboolean anchor_start, gboolean anchor_end,
+        const char *uri_end);
+static const char *match_part(const char *pattern, gsize len, const char *s,
+        const char *end, const char *uri_end);
+static gboolean is_separator(char c);
+
+
+Blocker *ext_block_new(void)
+{
+    Blocker *b = g_slice_new0(Blocker);
+
+    b->hosts         = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    b->allowed_hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    b->block         = keyword_set_new();
+    b->allow         = keyword_set_new();
+    b->rules         = g_ptr_array_new_with_free_func((GDestroyNotify)rule_free);
+
+    return b;
+}
+
+/**
+ * Add the hosts or filters of a list. Hosts files with or without IP address
+ * and EasyList filters can be mixed.
+ */
+void ext_block_add_list(Blocker *b, const char *data, gsize len)
+{
+    const char *p = data, *end = data + len, *nl;
+    char *line;
+
+    while (p < end) {
+        nl = memchr(p, '\n', end - p);
+        if (!nl) {
+            nl = end;
+        }
+        line = g_strndup(p, nl - p);
+        parse_line(b, line);
+        g_free(line);
+        p = nl + 1;
+    }
+}
+
+/**
+ * Add all lists in the directory.
+ */
+void ext_block_load_dir(Blocker *b, const char *dir)
+{
+    GDir *d;
+    const char *name;
+    char *file, *data;
+    gsize len;
+
+    d = g_dir_open(dir, 0, NULL);
+    if (!d) {
+        return;
+    }
+    while ((name = g_dir_read_name(d))) {
+        if (*name == '.') {
+            continue;
+        }
+        file = g_build_filename(dir, name, NULL);
+        if (g_file_get_contents(file, &data, &len, NULL)) {
+            ext_block_add_list(b, data, len);
+            g_free(data);
+        }
+        g_free(file);
+    }
+    g_dir_close(d);
+}
+
+/**
+ * Prepare the blocker for matching after all lists are added.
+ */
+void ext_block_compile(Blocker *b)
+{
+    keyword_set_compile(b->block);
+    keyword_set_compile(b->allow);
+}
+
+/**
+ * Checks if the request to uri should be blocked.
+ */
+gboolean ext_block_match(Blocker *b, const char *uri)
+{
+    Request req;
+    char host[256];
+    gsize i, hlen;
+
+    if (!b || !get_host(uri, &req.host, &req.host_end)) {
+        return FALSE;
+    }
+    hlen = req.host_end - req.host;
+    if (!hlen || hlen >= sizeof(host)) {
+        return FALSE;
+    }
+    for (i = 0; i < hlen; i++) {
+        host[i] = g_ascii_tolower(req.host[i]);
+    }
+    host[hlen] = '\0';
+    req.uri    = uri;
+    req.len    = strlen(uri);
+
+    if (!host_in(b->hosts, host) && !matches(b->block, &req)) {
+        return FALSE;
+    }
+
+    return !host_in(b->allowed_hosts, host) && !matches(b->allow, &req);
+}
+
+guint ext_block_rule_count(Blocker *b)
+{
+    return b ? b->count : 0;
+}
+
+void ext_block_free(Blocker *b)
+{
+    if (b) {
+        g_hash_table_destroy(b->hosts);
+        g_hash_table_destroy(b->allowed_hosts);
+        keyword_set_free(b->block);
+        keyword_set_free(b->allow);
+        g_ptr_array_unref(b->rules);
+        g_slice_free(Blocker, b);
+    }
+}
+
+static void parse_line(Blocker *b, char *line)
+{
+    gboolean allow = FALSE;
+    guint flags = 0;
+    char *p, *keyword, **tokens, **t;
+    gsize len, klen, i;
+
+    g_strstrip(line);
+    /* Skip empty lines, comments and list headers. */
+    if (!*line || *line == '!' || *line == '#' || *line == '[') {
+        return;
+    }
+    /* Element hiding rules are not about requests. */
+    if (strstr(line, "##") || strstr(line, "#@#") || strstr(line, "#?#")) {
+        return;
+    }
+
+    /* Hosts file entry 'address host...' or domain followed by a comment */
+    if (line[strcspn(line, " \t")]) {
+        tokens = g_strsplit_set(line, " \t", -1);
+        t      = g_hostname_is_ip_address(tokens[0]) ? tokens + 1 : tokens;
+        for (; *t && **t != '#'; t++) {
+            add_host(b->hosts, *t, &b->count);
+        }
+        g_strfreev(tokens);
+        return;
+    }
+
+    if (g_str_has_prefix(line, "@@")) {
+        allow = TRUE;
+        line += 2;
+    }
+    /* Options like $third-party or $script are not supported. Skip these
+     * filters instead of applying them to more requests than wanted. */
+    if (strchr(line, '$')) {
+        return;
+    }
+    len = strlen(line);
+    /* Regular expressions are not supported. */
+    if (len > 1 && line[0] == '/' && line[len - 1] == '/') {
+        return;
+    }
+
+    if (g_str_has_prefix(line, "||")) {
+        flags |= RULE_ANCHOR_HOST;
+        line  += 2;
+    } else if (*line == '|') {
+        flags |= RULE_ANCHOR_START;
+        line++;
+    }
+    len = strlen(line);
+    if (len && line[len - 1] == '|') {
+        flags |= RULE_ANCHOR_END;
+        line[--len] = '\0';
+    }
+    if (!len) {
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        line[i] = g_ascii_tolower(line[i]);
+    }
+
+    /* Plain domains and ||domain^ are looked up in the host tables. */
+    if (!allow && !flags && is_domain(line, len)) {
+        add_host(b->hosts, line, &b->count);
+        return;
+    }
+    if (flags == RULE_ANCHOR_HOST) {
+        klen = line[len - 1] == '^' ? len - 1 : len;
+        if (is_domain(line, klen)) {
+            line[klen] = '\0';
+            add_host(allow ? b->allowed_hosts : b->hosts, line, &b->count);
+            return;
+        }
+    }
+
+    /* Use the longest literal part of the pattern as keyword. */
+    keyword = NULL;
+    klen    = 0;
+    for (p = line; *p; ) {
+        len = strcspn(p, "*^");
+        if (len > klen) {
+            keyword = p;
+            klen    = len;
+        }
+        p += len;
+        if (*p) {
+            p++;
+        }
+    }
+    if (klen < MIN_KEYWORD_LEN) {
+        return;
+    }
+
+    add_rule(b, allow, keyword, klen, line, flags);
+}
+
+static void add_host(GHashTable *hosts, const char *host, guint *count)
+{
+    char *h;
+
+    if (!is_domain(host, strlen(host))) {
+        return;
+    }
+    h = g_ascii_strdown(host, -1);
+    if (g_hash_table_add(hosts, h)) {
+        (*count)++;
+    }
+}
+
+/**
+ * Checks if str is a domain name with at least two labels.
+ */
+static gboolean is_domain(const char *str, gsize len)
+{
+    gboolean dot = FALSE;
+    gsize i;
+
+    if (!len || str[0] == '.' || str[len - 1] == '.') {
+        return FALSE;
+    }
+    for (i = 0; i < len; i++) {
+        if (str[i] == '.') {
+            dot = TRUE;
+        } else if (!g_ascii_isalnum(str[i]) && str[i] != '-' && str[i] != '_') {
+            return FALSE;
+        }
+    }
+    return dot;
+}
+
+/**
+ * Checks if the host or one of its parent domains is in the table.
+ */
+static gboolean host_in(GHashTable *hosts, const char *host)
+{
+    const char *p = host;
+
+    if (!g_hash_table_size(hosts)) {
+        return FALSE;
+    }
+    while (p) {
+        if (g_hash_table_contains(hosts, p)) {
+            return TRUE;
+        }
+        if ((p = strchr(p, '.'))) {
+            p++;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Find the host part of the uri without user info and port.
+ */
+static gboolean get_host(const char *uri, const char **start, const char **end)
+{
+    const char *p, *s, *e;
+
+    if (!(p = strstr(uri, "://"))) {
+        return FALSE;
+    }
+    s = p + 3;
+    e = s + strcspn(s, "/?#");
+    for (p = s; p < e; p++) {
+        if (*p == '@') {
+            s = p + 1;
+        }
+    }
+    if (*s == '[') {
+        p = memchr(s, ']', e - s);
+        if (p) {
+            e = p + 1;
+        }
+    } else if ((p = memchr(s, ':', e - s))) {
+        e = p;
+    }
+    *start = s;
+    *end   = e;
+
+    return TRUE;
+}
+
+static void add_rule(Blocker *b, gboolean allow, const char *keyword,
+        gsize len, const char *pattern, guint flags)
+{
+    Rule *rule = g_slice_new(Rule);
+
+    rule->pattern     = g_strdup(pattern);
+    rule->len         = strlen(pattern);
+    rule->keyword     = keyword - pattern;
+    rule->keyword_len = len;
+    rule->flags       = flags;
+    g_ptr_array_add(b->rules, rule);
+    keyword_set_add(allow ? b->allow : b->block, keyword, len, rule);
+    b->count++;
+}
+
+/**
+ * Checks if one of the rules of the keyword set matches the request.
+ */
+static gboolean matches(KeywordSet *set, Request *req)
+{
+    return keyword_set_search(set, req->uri, req->len,
+            (KeywordSetFunc)rule_matches, req);
+}
+
+static void rule_free(Rule *rule)
+{
+    g_free(rule->pattern);
+    g_slice_free(Rule, rule);
+}
+
+/**
+ * Checks if the rule matches the request with its keyword found just before
+ * the offset end of the uri. The parts of the pattern before and after the
+ * keyword are matched independently of each other.
+ */
+static gboolean rule_matches(Rule *rule, gsize end, Request *req)
+{
+    const char *uri_end = req->uri + req->len;
+    const char *kw_start = req->uri + end - rule->keyword_len;
+    const char *right = rule->pattern + rule->keyword + rule->keyword_len;
+    const char *p;
+
+    if (!match_glob(right, rule->len - (right - rule->pattern), req->uri + end,
+            uri_end, TRUE, rule->flags & RULE_ANCHOR_END, uri_end)) {
+        return FALSE;
+    }
+    if (rule->flags & RULE_ANCHOR_HOST) {
+        /* The pattern must start at the beginning of a domain label. */
+        for (p = req->host; p < req->host_end && p <= kw_start; p++) {
+            if ((p == req->host || p[-1] == '.')
+                    && match_glob(rule->pattern, rule->keyword, p, kw_start,
+                        TRUE, TRUE, uri_end)) {
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+
+    return match_glob(rule->pattern, rule->keyword, req->uri, kw_start,
+            rule->flags & RULE_ANCHOR_START, TRUE, uri_end);
+}
+
+/**
+ * Match the first len chars of the filter pattern against the string from s
+ * to end. A '*' matches any string and '^' a separator char or the end of the
+ * uri. The literal parts between the '*' are searched from left to right,
+ * which takes linear time per part, so that patterns with many '*' don't
+ * backtrack.
+ *
+ * @anchor_start: The pattern must match at s.
+ * @anchor_end:   The pattern must match up to end.
+ */
+static gboolean match_glob(const char *pattern, gsize len, const char *s,
+        const char *end, gboolean anchor_start, gboolean anchor_end,
+        const char *uri_end)
+{
+    const char *pend = pattern + len, *star, *p, *e;
+    gsize plen;
+
+    /* The part before the first '*' must match at the start. */
+    star = memchr(pattern, '*', len);
+    if (anchor_start) {
+        plen = star ? star - pattern : len;
+        if (!(s = match_part(pattern, plen, s, end, uri_end))) {
+            return FALSE;
+        }
+        if (!star) {
+            return !anchor_end || s == end;
+        }
+        pattern = star;
+    }
+
+    while (pattern < pend) {
+        /* skip the '*' before the next part */
+        while (pattern < pend && *pattern == '*') {
+            pattern++;
+        }
+        if (pattern == pend) {
+            return TRUE;
+        }
+        star = memchr(pattern, '*', pend - pattern);
+        plen = star ? star - pattern : pend - pattern;
+
+        /* The last part of an anchored pattern must match up to end. */
+        if (!star && anchor_end) {
+            for (p = end - MIN(plen, (gsize)(end - s)); p <= end; p++) {
+                if ((e = match_part(pattern, plen, p, end, uri_end)) && e == end) {
+                    return TRUE;
+                }
+            }
+            return FALSE;
+        }
+
+        /* Take the leftmost match of the part, which leaves the most room
+         * for the following parts. */
+        for (e = NULL, p = s; p <= end && !e; p++) {
+            e = match_part(pattern, plen, p, end, uri_end);
+        }
+        if (!e) {
+            return FALSE;
+        }
+        s       = e;
+        pattern = star ? star : pend;
+    }
+
+    /* Only an empty pattern gets here if anchor_end is set. */
+    return !anchor_end || !anchor_start || s == end;
+}
+
+/**
+ * Match a part of a pattern without '*' at s. Returns the end of the matched
+ * string or NULL.
+ */
+static const char *match_part(const char *pattern, gsize len, const char *s,
+        const char *end, const char *uri_end)
+{
+    const char *pend = pattern + len;
+
+    for (; pattern < pend; pattern++) {
+        if (*pattern == '^') {
+            /* matches the end of the uri without consuming a char */
+            if (s == uri_end) {
+                continue;
+            }
+            if (s == end || !is_separator(*s)) {
+                return NULL;
+            }
+        } else if (s == end || g_ascii_tolower(*s) != *pattern) {
+            return NULL;
+        }
+        s++;
+    }
+
+    return s;
+}
+
+static gboolean is_separator(char c)
+{
+    return !g_ascii_isalnum(c) && c != '_' && c != '-' && c != '.' && c != '%';
+}
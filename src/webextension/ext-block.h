@@ -0,0 +1,35 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _EXT_BLOCK_H
+#define _EXT_BLOCK_H
+
+#include <glib.h>
+
+typedef struct Blocker Blocker;
+
+Blocker *ext_block_new(void);
+void ext_block_add_list(Blocker *b, const char *data, gsize len);
+void ext_block_load_dir(Blocker *b, const char *dir);
+void ext_block_compile(Blocker *b);
+gboolean ext_block_match(Blocker *b, const char *uri);
+guint ext_block_rule_count(Blocker *b);
+void ext_block_free(Blocker *b);
+
+#endif /* end of include guard: _EXT_BLOCK_H */
@@ -0,0 +1,198 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
+#include <webkit2/webkit-web-extension.h>
+
+#include "ext-headers.h"
+
+/* A header to set or remove on requests to a domain. */
+typedef struct {
+    char *domain;   /* NULL for all hosts */
+    char *name;
+    char *value;    /* NULL to remove the header */
+} Rule;
+
+struct HeaderRules {
+    GPtrArray  *global;     /* rules for all hosts */
+    GHashTable *domains;    /* registrable domain -> GPtrArray of rules */
+};
+
+static const char *domain_key(const char *domain);
+static gboolean host_matches(const char *host, const char *domain);
+static void apply_rules(GPtrArray *list, const char *host,
+        SoupMessageHeaders *headers);
+static void rule_free(Rule *rule);
+
+
+/**
+ * Compile the (domain, name, remove, value) tuples of the a(ssbs) rules.
+ * Rules with empty domain apply to all hosts. Returns NULL if there are no
+ * rules at all.
+ */
+HeaderRules *ext_headers_new(GVariant *rules)
+{
+    HeaderRules *hr;
+    GVariantIter iter;
+    GPtrArray *list;
+    const char *domain, *name, *value, *key;
+    gboolean remove;
+    Rule *rule;
+
+    if (!g_variant_n_children(rules)) {
+        return NULL;
+    }
+
+    hr          = g_slice_new(HeaderRules);
+    hr->global  = g_ptr_array_new_with_free_func((GDestroyNotify)rule_free);
+    hr->domains = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)g_ptr_array_unref);
+
+    g_variant_iter_init(&iter, rules);
+    while (g_variant_iter_next(&iter, "(&s&sb&s)", &domain, &name, &remove, &value)) {
+        rule        = g_slice_new(Rule);
+        rule->name  = g_strdup(name);
+        rule->value = remove ? NULL : g_strdup(value);
+        if (!*domain) {
+            rule->domain = NULL;
+            g_ptr_array_add(hr->global, rule);
+            continue;
+        }
+
+        rule->domain = g_ascii_strdown(domain, -1);
+        key  = domain_key(rule->domain);
+        list = g_hash_table_lookup(hr->domains, key);
+        if (!list) {
+            list = g_ptr_array_new_with_free_func((GDestroyNotify)rule_free);
+            g_hash_table_insert(hr->domains, g_strdup(key), list);
+        }
+        g_ptr_array_add(list, rule);
+    }
+
+    return hr;
+}
+
+/**
+ * Set or remove the headers of the request for which a rule exists. Rules
+ * for all hosts are applied first, so that domain rules can override them.
+ */
+void ext_headers_apply(HeaderRules *rules, WebKitURIRequest *request)
+{
+    SoupMessageHeaders *headers;
+    SoupURI *uri;
+    GPtrArray *list;
+    char *host;
+
+    if (!rules) {
+        return;
+    }
+    headers = webkit_uri_request_get_http_headers(request);
+    if (!headers) {
+        return;
+    }
+
+    if (rules->global->len) {
+        apply_rules(rules->global, NULL, headers);
+    }
+
+    /* Nothing more to do if there are no domain rules. */
+    if (!g_hash_table_size(rules->domains)) {
+        return;
+    }
+    uri = soup_uri_new(webkit_uri_request_get_uri(request));
+    if (!uri || !uri->host) {
+        goto out;
+    }
+    host = g_ascii_strdown(uri->host, -1);
+    list = g_hash_table_lookup(rules->domains, domain_key(host));
+    if (list) {
+        apply_rules(list, host, headers);
+    }
+    g_free(host);
+
+out:
+    if (uri) {
+        soup_uri_free(uri);
+    }
+}
+
+void ext_headers_free(HeaderRules *rules)
+{
+    if (rules) {
+        g_ptr_array_unref(rules->global);
+        g_hash_table_destroy(rules->domains);
+        g_slice_free(HeaderRules, rules);
+    }
+}
+
+/**
+ * Returns the key of the domain in the table of domain rules. That is the
+ * registrable domain, so that a single lookup finds the rules of all
+ * subdomains. Hosts without registrable domain like IP addresses are used
+ * as they are. The returned string points into domain.
+ */
+static const char *domain_key(const char *domain)
+{
+    const char *base = soup_tld_get_base_domain(domain, NULL);
+
+    return base ? base : domain;
+}
+
+/**
+ * Checks if host is the domain or one of its subdomains.
+ */
+static gboolean host_matches(const char *host, const char *domain)
+{
+    size_t hlen = strlen(host), dlen = strlen(domain);
+
+    if (hlen < dlen || strcmp(host + hlen - dlen, domain)) {
+        return FALSE;
+    }
+
+    return hlen == dlen || host[hlen - dlen - 1] == '.';
+}
+
+static void apply_rules(GPtrArray *list, const char *host,
+        SoupMessageHeaders *headers)
+{
+    Rule *rule;
+    guint i;
+
+    for (i = 0; i < list->len; i++) {
+        rule = g_ptr_array_index(list, i);
+        if (rule->domain && !host_matches(host, rule->domain)) {
+            continue;
+        }
+        if (rule->value) {
+            soup_message_headers_replace(headers, rule->name, rule->value);
+        } else {
+            soup_message_headers_remove(headers, rule->name);
+        }
+    }
+}
+
+static void rule_free(Rule *rule)
+{
+    g_free(rule->domain);
+    g_free(rule->name);
+    g_free(rule->value);
+    g_slice_free(Rule, rule);
+}
@@ -0,0 +1,32 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _EXT_HEADERS_H
+#define _EXT_HEADERS_H
+
+#include <glib.h>
+#include <webkit2/webkit-web-extension.h>
+
+typedef struct HeaderRules HeaderRules;
+
+HeaderRules *ext_headers_new(GVariant *rules);
+void ext_headers_apply(HeaderRules *rules, WebKitURIRequest *request);
+void ext_headers_free(HeaderRules *rules);
+
+#endif /* end of include guard: _EXT_HEADERS_H */
@@ -0,0 +1,1869 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <JavaScriptCore/JavaScript.h>
+#include <webkit2/webkit-web-extension.h>
+#include <webkitdom/webkitdom.h>
+
+#include "ext-hints.h"
+#include "ext-js.h"
+#include "ext-util.h"
+
+#define HINT_ATTR     "vimbhint"
+#define HINTS_DATA    "vimb-hints"
+#define LABEL_MAX_LEN 20
+#define INDEX_DATA    "vimb-hints-index"
+#define MAX_PENDING   1024
+
+/* CSS selectors of the hintable elements for the hint modes. */
+static const struct {
+    const char *modes;
+    const char *selector;
+} selectors[] = {
+    {"otY",     "[href], [onclick], [tabindex], [class='lk'], [role='link'], "
+                "[role='button'], "
+                "input:not([type='hidden']):not([disabled]):not([readonly]), "
+                "textarea:not([disabled]):not([readonly]), button, select"},
+    {"e",       "input:not([type]), input[type='text'], textarea"},
+    {"iI",      "img[src]"},
+    {"OpPsTxy", "[href], img[src]:not(a img), iframe[src]"},
+};
+
+/* Attributes used by the selectors. Changing them may add or remove
+ * hintable elements. */
+#define SELECTOR_ATTRS "href onclick tabindex class role type disabled readonly src"
+
+typedef enum {
+    HINT_NONE,
+    HINT_HIDDEN,
+    HINT_VISIBLE,
+    HINT_FOCUS,
+} HintState;
+
+typedef struct {
+    WebKitDOMElement *elem;
+    WebKitDOMElement *label;
+    char             *text;      /* text shown in the label */
+    char             *ltext;     /* lowercased text to match the filter */
+    gboolean         show_text;
+    char             *num;       /* the hint label number/letters */
+    char             *shown;     /* text currently set to the label */
+    HintState        state;
+    double           top;        /* position of the label */
+    double           left;
+} Hint;
+
+typedef struct {
+    WebKitDOMDocument *doc;
+    WebKitDOMElement  *div;      /* container for the hint labels */
+} HintDoc;
+
+typedef struct {
+    double left;
+    double right;
+    double top;
+    double bottom;
+} Offsets;
+
+typedef struct {
+    const char *keys;
+    int        len;
+    int        num;              /* 1 if keys are numeric else 0 */
+    int        offset;
+    int        count;
+} Labeler;
+
+typedef struct {
+    WebKitWebPage *page;
+    char          mode;
+    gboolean      keep_open;
+    gboolean      follow_last;
+    gboolean      same_length;
+    guint         max_hints;
+    char          *keys;
+    int           selector;     /* index into selectors or -1 */
+    GPtrArray     *hints;        /* all hints within the viewport */
+    GPtrArray     *valid;        /* hints matching the filters */
+    GSList        *docs;         /* documents holding hint labels */
+    GSList        *targets;      /* event targets observed for resize and scroll */
+    GSList        *indexed;      /* documents whose index listens for DOM changes */
+    Hint          *active;
+    char          *filter_text;
+    GString       *filter_keys;
+} Hints;
+
+typedef struct {
+    WebKitWebPage    *page;
+    WebKitDOMElement *elem;
+} OpenData;
+
+typedef struct {
+    WebKitDOMElement *elem;
+    double           top;        /* box in document coordinates */
+    double           bottom;
+} IndexEntry;
+
+/* Hintable elements of a document for one of the selectors. */
+typedef struct {
+    GHashTable *members;         /* all elements matching the selector */
+    guint     generation;        /* layout generation the entries are for */
+    GArray    *entries;          /* IndexEntry sorted by top */
+    /* Elements that do not scroll with the document like fixed or sticky
+     * ones, elements that where hidden or taller than the viewport. These
+     * are checked on each hinting. */
+    GPtrArray *always;
+    double    max_height;        /* height of the tallest entry */
+} Index;
+
+typedef struct {
+    WebKitDOMDocument *doc;
+    guint             generation;  /* incremented on each layout change */
+    Index             *index[G_N_ELEMENTS(selectors)];
+    /* DOM changes not applied to the indices yet. */
+    GPtrArray         *inserted;   /* roots of inserted subtrees */
+    GHashTable        *changed;    /* elements with changed attributes */
+    gboolean          removed;     /* nodes have been removed */
+    gboolean          rebuild;     /* too many changes to track */
+    JsObserver        *observer;   /* MutationObserver of the main document */
+    gboolean          listening;   /* DOM mutation events are observed */
+} DocIndex;
+
+static Hints *get_hints(WebKitWebPage *page, gboolean create);
+static void hints_free(Hints *hints);
+static void observe(Hints *hints);
+static void unobserve(Hints *hints);
+static void on_resize(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        Hints *hints);
+static void create(Hints *hints);
+static void create_for_document(Hints *hints, WebKitDOMDocument *doc,
+        Offsets offsets, guint *count);
+static void remove_hints(Hints *hints);
+static void clear(Hints *hints);
+static char *show(Hints *hints, gboolean fire_last);
+static char *focus_hint(Hints *hints, guint idx);
+static char *fire(Hints *hints);
+static char *handle_form(WebKitDOMElement *elem);
+static char *action(Hints *hints, WebKitDOMElement *elem);
+static gboolean open_cb(gpointer data);
+static Hint *hint_new(WebKitDOMDocument *doc, WebKitDOMElement *elem);
+static void hint_free(Hint *hint);
+static void hint_show(Hint *hint);
+static void hint_hide(Hint *hint);
+static void hint_focus(Hint *hint);
+static void hint_unfocus(Hint *hint);
+static char *get_text(WebKitDOMElement *elem, gboolean *show_text);
+static char *get_src(WebKitDOMElement *elem);
+static gboolean is_visible(WebKitDOMElement *elem, WebKitDOMDOMWindow *win,
+        const Offsets *offsets);
+static gboolean has_visible_child(WebKitDOMElement *elem,
+        WebKitDOMDOMWindow *win, const Offsets *offsets);
+static gboolean match_text(char **tokens, const char *text);
+static void mouse_event(WebKitDOMElement *elem, const char *type);
+static void set_style(WebKitDOMElement *elem, const char *property,
+        const char *value);
+static void labeler_init(Labeler *labeler, const char *keys,
+        gboolean same_length, guint count);
+static char *labeler_next(Labeler *labeler);
+static GPtrArray *index_query(Hints *hints, WebKitDOMDocument *doc,
+        WebKitDOMDOMWindow *win, const Offsets *offsets);
+static DocIndex *doc_index_get(WebKitWebPage *page, WebKitDOMDocument *doc);
+static void doc_index_free(DocIndex *di);
+static void doc_index_listen(DocIndex *di, gboolean listen);
+static void doc_index_update(DocIndex *di);
+static void doc_index_clear_pending(DocIndex *di);
+static gboolean doc_index_tracks(DocIndex *di);
+static void doc_index_record(DocIndex *di, WebKitDOMEventTarget *node,
+        gboolean inserted);
+static void on_mutations(guint changes, GPtrArray *added, GPtrArray *changed,
+        DocIndex *di);
+static void on_layout_change(WebKitDOMEventTarget *target,
+        WebKitDOMEvent *event, DocIndex *di);
+static void on_dom_change(WebKitDOMEventTarget *target,
+        WebKitDOMEvent *event, DocIndex *di);
+static Index *index_new(WebKitDOMDocument *doc, const char *selector);
+static void index_free(Index *index);
+static void index_add_subtree(Index *index, WebKitDOMElement *root,
+        const char *selector);
+static gboolean is_detached(WebKitDOMElement *elem, gpointer value,
+        WebKitDOMDocument *doc);
+static void index_measure(Index *index, WebKitDOMDOMWindow *win);
+static gboolean is_out_of_flow(WebKitDOMElement *elem, WebKitDOMDOMWindow *win,
+        GHashTable *memo);
+static int compare_entries(const void *a, const void *b);
+static int compare_hints(const void *a, const void *b);
+
+/* Greater than zero while the hints change the DOM themselves. */
+static guint own_changes = 0;
+
+
+/**
+ * Starts hinting on the given page. Previous hints of the page are removed.
+ *
+ * Returns the result of the hinting as string like "OVER:A:uri" or "DONE:"
+ * or NULL. The returned string must be freed.
+ */
+char *ext_hints_init(WebKitWebPage *page, char mode, gboolean keep_open,
+        guint max_hints, const char *keys, gboolean follow_last,
+        gboolean keys_same_length)
+{
+    Hints *hints;
+    int i;
+
+    hints = get_hints(page, TRUE);
+    clear(hints);
+
+    hints->selector = -1;
+    for (i = 0; i < G_N_ELEMENTS(selectors); i++) {
+        if (mode && strchr(selectors[i].modes, mode)) {
+            hints->selector = i;
+            break;
+        }
+    }
+    if (hints->selector < 0) {
+        return g_strdup("ERROR:");
+    }
+
+    g_free(hints->keys);
+    /* Fall back to numeric hints to not divide by zero in the labeler. */
+    hints->keys        = g_strdup(keys && *keys ? keys : "0123456789");
+    hints->mode        = mode;
+    hints->keep_open   = keep_open;
+    hints->max_hints   = max_hints;
+    hints->follow_last = follow_last;
+    hints->same_length = keys_same_length;
+
+    observe(hints);
+    create(hints);
+
+    return show(hints, TRUE);
+}
+
+/**
+ * Filters the hints by the given text. Each whitespace separated token of the
+ * text must be found in the text of the hinted element.
+ */
+char *ext_hints_filter(WebKitWebPage *page, const char *text)
+{
+    Hints *hints = get_hints(page, FALSE);
+
+    if (!hints || hints->selector < 0) {
+        return g_strdup("ERROR:");
+    }
+
+    /* Remove previously set hint-keys filters to make the filter easier to
+     * understand for the users. */
+    g_string_truncate(hints->filter_keys, 0);
+    g_free(hints->filter_text);
+    hints->filter_text = g_utf8_strdown(text ? text : "", -1);
+
+    return show(hints, TRUE);
+}
+
+/**
+ * Adds the given hint key to the hint-keys filter. If key is NULL or empty
+ * the last key of the filter is removed.
+ */
+char *ext_hints_update(WebKitWebPage *page, const char *key)
+{
+    Hints *hints = get_hints(page, FALSE);
+
+    if (!hints || hints->selector < 0) {
+        return g_strdup("ERROR:");
+    }
+
+    if (!key || !*key) {
+        /* Delete last hint-keys filter char. */
+        if (hints->filter_keys->len) {
+            g_string_truncate(hints->filter_keys, hints->filter_keys->len - 1);
+            return show(hints, FALSE);
+        }
+        return g_strdup("ERROR:");
+    }
+
+    if (strchr(hints->keys, *key)) {
+        g_string_append_c(hints->filter_keys, *key);
+        return show(hints, TRUE);
+    }
+
+    return g_strdup("ERROR:");
+}
+
+/**
+ * Moves the focus to the next or previous valid hint.
+ */
+char *ext_hints_focus(WebKitWebPage *page, gboolean back)
+{
+    Hints *hints = get_hints(page, FALSE);
+    int idx, len;
+
+    if (!hints || !hints->valid->len) {
+        return NULL;
+    }
+
+    len = hints->valid->len;
+    for (idx = 0; idx < len; idx++) {
+        if (g_ptr_array_index(hints->valid, idx) == hints->active) {
+            break;
+        }
+    }
+    /* previous active hint not found */
+    if (idx >= len) {
+        idx = 0;
+    }
+
+    if (back) {
+        idx = idx > 0 ? idx - 1 : len - 1;
+    } else {
+        idx = idx < len - 1 ? idx + 1 : 0;
+    }
+
+    return focus_hint(hints, idx);
+}
+
+/**
+ * Fires the currently focused hint.
+ */
+char *ext_hints_fire(WebKitWebPage *page)
+{
+    Hints *hints = get_hints(page, FALSE);
+
+    if (!hints) {
+        return g_strdup("ERROR:");
+    }
+
+    return fire(hints);
+}
+
+/**
+ * Removes all hints and the labels from the page.
+ */
+void ext_hints_clear(WebKitWebPage *page)
+{
+    Hints *hints = get_hints(page, FALSE);
+
+    if (hints) {
+        clear(hints);
+    }
+}
+
+/**
+ * Retrieves the hints state stored on the page. If create is TRUE the state
+ * is created if it does not exist yet.
+ */
+static Hints *get_hints(WebKitWebPage *page, gboolean create)
+{
+    Hints *hints = g_object_get_data(G_OBJECT(page), HINTS_DATA);
+
+    if (!hints && create) {
+        hints              = g_slice_new0(Hints);
+        hints->page        = page;
+        hints->selector    = -1;
+        hints->hints       = g_ptr_array_new_with_free_func((GDestroyNotify)hint_free);
+        hints->valid       = g_ptr_array_new();
+        hints->filter_keys = g_string_new(NULL);
+
+        g_object_set_data_full(G_OBJECT(page), HINTS_DATA, hints,
+                (GDestroyNotify)hints_free);
+    }
+
+    return hints;
+}
+
+static void hints_free(Hints *hints)
+{
+    clear(hints);
+    g_ptr_array_free(hints->hints, TRUE);
+    g_ptr_array_free(hints->valid, TRUE);
+    g_string_free(hints->filter_keys, TRUE);
+    g_free(hints->keys);
+    g_slice_free(Hints, hints);
+}
+
+/**
+ * Observe resize and scroll events of the page and the frames to refresh the
+ * hints.
+ */
+static void observe(Hints *hints)
+{
+    WebKitDOMDocument *doc, *frame_doc;
+    WebKitDOMDOMWindow *win;
+    WebKitDOMNodeList *frames;
+    WebKitDOMNode *node;
+    gulong i, len;
+
+    doc = webkit_web_page_get_dom_document(hints->page);
+    win = webkit_dom_document_get_default_view(doc);
+    if (!win) {
+        return;
+    }
+
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(win),
+            "resize", G_CALLBACK(on_resize), TRUE, hints);
+    webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(win),
+            "scroll", G_CALLBACK(on_resize), FALSE, hints);
+    hints->targets = g_slist_prepend(hints->targets, win);
+
+    frames = webkit_dom_document_query_selector_all(doc, "iframe, frame", NULL);
+    if (!frames) {
+        return;
+    }
+    len = webkit_dom_node_list_get_length(frames);
+    for (i = 0; i < len; i++) {
+        node = webkit_dom_node_list_item(frames, i);
+        if (WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(node)) {
+            frame_doc = webkit_dom_html_iframe_element_get_content_document(
+                    WEBKIT_DOM_HTML_IFRAME_ELEMENT(node));
+        } else {
+            frame_doc = webkit_dom_html_frame_element_get_content_document(
+                    WEBKIT_DOM_HTML_FRAME_ELEMENT(node));
+        }
+        if (frame_doc) {
+            webkit_dom_event_target_add_event_listener(
+                    WEBKIT_DOM_EVENT_TARGET(frame_doc), "scroll",
+                    G_CALLBACK(on_resize), FALSE, hints);
+            hints->targets = g_slist_prepend(hints->targets,
+                    g_object_ref(frame_doc));
+        }
+    }
+    g_object_unref(frames);
+}
+
+static void unobserve(Hints *hints)
+{
+    GSList *l;
+
+    for (l = hints->targets; l; l = l->next) {
+        webkit_dom_event_target_remove_event_listener(
+                WEBKIT_DOM_EVENT_TARGET(l->data), "resize",
+                G_CALLBACK(on_resize), TRUE);
+        webkit_dom_event_target_remove_event_listener(
+                WEBKIT_DOM_EVENT_TARGET(l->data), "scroll",
+                G_CALLBACK(on_resize), FALSE);
+    }
+    g_slist_free_full(hints->targets, (GDestroyNotify)g_object_unref);
+    hints->targets = NULL;
+
+    for (l = hints->indexed; l; l = l->next) {
+        doc_index_listen(g_object_get_data(G_OBJECT(l->data), INDEX_DATA), FALSE);
+    }
+    g_slist_free_full(hints->indexed, (GDestroyNotify)g_object_unref);
+    hints->indexed = NULL;
+}
+
+/**
+ * Recreate the hints for the new viewport. The filters are kept.
+ */
+static void on_resize(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
+        Hints *hints)
+{
+    remove_hints(hints);
+    create(hints);
+    g_free(show(hints, FALSE));
+}
+
+/**
+ * Collect the visible hintable elements of the page and all its frames.
+ */
+static void create(Hints *hints)
+{
+    Offsets offsets = {0};
+    guint count     = 0;
+
+    create_for_document(hints, webkit_web_page_get_dom_document(hints->page),
+            offsets, &count);
+}
+
+/**
+ * Collect the hints of the given document.
+ *
+ * @offsets: Distances from the document viewport edges that are covered by
+ *           the parent documents.
+ * @count:   Number of hints created so far.
+ */
+static void create_for_document(Hints *hints, WebKitDOMDocument *doc,
+        Offsets offsets, guint *count)
+{
+    WebKitDOMDOMWindow *win;
+    WebKitDOMNodeList *list;
+    WebKitDOMDocumentFragment *fragment;
+    WebKitDOMElement *elem, *div;
+    WebKitDOMHTMLElement *body;
+    WebKitDOMDocument *frame_doc;
+    WebKitDOMClientRect *rect;
+    GPtrArray *elems, *visible;
+    HintDoc *hdoc;
+    Hint *hint;
+    Offsets frame_offsets;
+    gulong i, len;
+
+    win = webkit_dom_document_get_default_view(doc);
+    if (!win) {
+        return;
+    }
+
+    offsets.right  = webkit_dom_dom_window_get_inner_width(win) - offsets.right;
+    offsets.bottom = webkit_dom_dom_window_get_inner_height(win) - offsets.bottom;
+
+    /* Get only the candidates around the viewport from the index. */
+    elems = index_query(hints, doc, win, &offsets);
+    if (elems) {
+        own_changes++;
+        visible = g_ptr_array_new();
+        for (i = 0; i < elems->len; i++) {
+            elem = g_ptr_array_index(elems, i);
+            if (is_visible(elem, win, &offsets)) {
+                g_ptr_array_add(visible, hint_new(doc, elem));
+            }
+        }
+        g_ptr_array_free(elems, TRUE);
+
+        /* Label the hints in the order they are shown from top to bottom. */
+        g_ptr_array_sort(visible, compare_hints);
+
+        fragment = webkit_dom_document_create_document_fragment(doc);
+        for (i = 0; i < visible->len; i++) {
+            hint = g_ptr_array_index(visible, i);
+            if (*count >= hints->max_hints) {
+                hint_free(hint);
+                continue;
+            }
+            (*count)++;
+
+            webkit_dom_node_append_child(WEBKIT_DOM_NODE(fragment),
+                    WEBKIT_DOM_NODE(hint->label), NULL);
+            webkit_dom_element_set_attribute(hint->elem, HINT_ATTR, "hint", NULL);
+            g_ptr_array_add(hints->hints, hint);
+        }
+        g_ptr_array_free(visible, TRUE);
+
+        /* All labels are placed once within a single layer. Filtering only
+         * toggles the visibility of the changed labels, which does not
+         * require a new layout of the page. */
+        div = webkit_dom_document_create_element(doc, "div", NULL);
+        webkit_dom_element_set_attribute(div, HINT_ATTR, "container", NULL);
+        webkit_dom_element_set_attribute(div, "style",
+                "position:fixed;top:0;left:0;width:0;height:0;"
+                "will-change:transform;z-index:225000", NULL);
+        webkit_dom_node_append_child(WEBKIT_DOM_NODE(div),
+                WEBKIT_DOM_NODE(fragment), NULL);
+        body = webkit_dom_document_get_body(doc);
+        if (body) {
+            webkit_dom_node_append_child(WEBKIT_DOM_NODE(body),
+                    WEBKIT_DOM_NODE(div), NULL);
+        }
+
+        hdoc       = g_slice_new(HintDoc);
+        hdoc->doc  = g_object_ref(doc);
+        hdoc->div  = g_object_ref(div);
+        hints->docs = g_slist_prepend(hints->docs, hdoc);
+        own_changes--;
+    }
+
+    /* Recurse into any iframe or frame element. */
+    list = webkit_dom_document_query_selector_all(doc, "iframe, frame", NULL);
+    if (list) {
+        len = webkit_dom_node_list_get_length(list);
+        for (i = 0; i < len; i++) {
+            elem = WEBKIT_DOM_ELEMENT(webkit_dom_node_list_item(list, i));
+            if (WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(elem)) {
+                frame_doc = webkit_dom_html_iframe_element_get_content_document(
+                        WEBKIT_DOM_HTML_IFRAME_ELEMENT(elem));
+            } else {
+                frame_doc = webkit_dom_html_frame_element_get_content_document(
+                        WEBKIT_DOM_HTML_FRAME_ELEMENT(elem));
+            }
+            if (!frame_doc || !is_visible(elem, win, &offsets)) {
+                continue;
+            }
+
+            rect = webkit_dom_element_get_bounding_client_rect(elem);
+            frame_offsets.left   = MAX(offsets.left - webkit_dom_client_rect_get_left(rect), 0);
+            frame_offsets.right  = MAX(webkit_dom_client_rect_get_right(rect) - offsets.right, 0);
+            frame_offsets.top    = MAX(offsets.top - webkit_dom_client_rect_get_top(rect), 0);
+            frame_offsets.bottom = MAX(webkit_dom_client_rect_get_bottom(rect) - offsets.bottom, 0);
+            g_object_unref(rect);
+
+            create_for_document(hints, frame_doc, frame_offsets, count);
+        }
+        g_object_unref(list);
+    }
+
+    g_object_unref(win);
+}
+
+/**
+ * Remove the hint labels and hint attributes from the documents.
+ */
+static void remove_hints(Hints *hints)
+{
+    WebKitDOMNode *parent;
+    HintDoc *hdoc;
+    GSList *l;
+    guint i;
+
+    own_changes++;
+    for (i = 0; i < hints->hints->len; i++) {
+        webkit_dom_element_remove_attribute(
+                ((Hint*)g_ptr_array_index(hints->hints, i))->elem, HINT_ATTR);
+    }
+    for (l = hints->docs; l; l = l->next) {
+        hdoc   = l->data;
+        parent = webkit_dom_node_get_parent_node(WEBKIT_DOM_NODE(hdoc->div));
+        if (parent) {
+            webkit_dom_node_remove_child(parent, WEBKIT_DOM_NODE(hdoc->div), NULL);
+        }
+        g_object_unref(hdoc->div);
+        g_object_unref(hdoc->doc);
+        g_slice_free(HintDoc, hdoc);
+    }
+    g_slist_free(hints->docs);
+    hints->docs   = NULL;
+    hints->active = NULL;
+    g_ptr_array_set_size(hints->valid, 0);
+    g_ptr_array_set_size(hints->hints, 0);
+    own_changes--;
+}
+
+/**
+ * Remove the hints and reset the filters.
+ */
+static void clear(Hints *hints)
+{
+    unobserve(hints);
+    remove_hints(hints);
+
+    g_free(hints->filter_text);
+    hints->filter_text = NULL;
+    g_string_truncate(hints->filter_keys, 0);
+}
+
+/**
+ * Apply the filters to the hints and show the matching ones.
+ *
+ * @fire_last: If TRUE and hint-follow-last is enabled the hint is fired if
+ *             there is only one left.
+ */
+static char *show(Hints *hints, gboolean fire_last)
+{
+    GPtrArray *candidates;
+    Labeler labeler;
+    Hint *hint;
+    char **tokens;
+    guint i;
+
+    tokens     = g_strsplit_set(hints->filter_text ? hints->filter_text : "", " \t\n\r\f\v", -1);
+    candidates = g_ptr_array_sized_new(hints->hints->len);
+
+    own_changes++;
+    /* Check which hints match to the filter. */
+    for (i = 0; i < hints->hints->len; i++) {
+        hint = g_ptr_array_index(hints->hints, i);
+        if (match_text(tokens, hint->ltext)) {
+            g_ptr_array_add(candidates, hint);
+        } else {
+            hint_hide(hint);
+        }
+    }
+    g_strfreev(tokens);
+
+    /* Now we can assign the hint labels and check if those match. */
+    g_ptr_array_set_size(hints->valid, 0);
+    labeler_init(&labeler, hints->keys, hints->same_length, candidates->len);
+    for (i = 0; i < candidates->len; i++) {
+        hint = g_ptr_array_index(candidates, i);
+        g_free(hint->num);
+        hint->num = labeler_next(&labeler);
+        if (g_str_has_prefix(hint->num, hints->filter_keys->str)) {
+            hint_show(hint);
+            g_ptr_array_add(hints->valid, hint);
+        } else {
+            hint_hide(hint);
+        }
+    }
+    g_ptr_array_free(candidates, TRUE);
+    own_changes--;
+
+    if (fire_last && hints->follow_last && hints->valid->len <= 1) {
+        g_free(focus_hint(hints, 0));
+        return fire(hints);
+    }
+
+    /* If the previous active hint isn't valid set focus to first. */
+    for (i = 0; i < hints->valid->len; i++) {
+        if (g_ptr_array_index(hints->valid, i) == hints->active) {
+            return NULL;
+        }
+    }
+    return focus_hint(hints, 0);
+}
+
+/**
+ * Set the focus to the valid hint with given index.
+ */
+static char *focus_hint(Hints *hints, guint idx)
+{
+    char *src, *result;
+
+    /* Reset previous focused hint. */
+    if (hints->active) {
+        own_changes++;
+        hint_unfocus(hints->active);
+        own_changes--;
+        mouse_event(hints->active->elem, "mouseout");
+    }
+
+    if (idx >= hints->valid->len) {
+        hints->active = NULL;
+        return NULL;
+    }
+
+    hints->active = g_ptr_array_index(hints->valid, idx);
+    own_changes++;
+    hint_focus(hints->active);
+    own_changes--;
+    mouse_event(hints->active->elem, "mouseover");
+
+    src    = get_src(hints->active->elem);
+    result = g_strconcat("OVER:",
+            WEBKIT_DOM_IS_HTML_IMAGE_ELEMENT(hints->active->elem) ? "I:" : "A:",
+            src, NULL);
+    g_free(src);
+
+    return result;
+}
+
+static char *fire(Hints *hints)
+{
+    WebKitDOMElement *elem;
+    char *result = NULL;
+
+    if (!hints->active) {
+        return g_strdup("ERROR:");
+    }
+
+    /* Keep the element alive, the hint is freed by clear(). */
+    elem = g_object_ref(hints->active->elem);
+
+    /* Process form actions like focus toggling inputs. Don't handle form for
+     * Y to allow to yank form field content instead of switching to input
+     * mode. */
+    if (strchr("eot", hints->mode)) {
+        result = handle_form(elem);
+    }
+
+    if (hints->keep_open) {
+        /* reset the hint-keys filter */
+        g_string_truncate(hints->filter_keys, 0);
+        g_free(show(hints, FALSE));
+    } else {
+        clear(hints);
+    }
+
+    if (!result) {
+        result = action(hints, elem);
+    }
+    g_object_unref(elem);
+
+    return result;
+}
+
+/**
+ * Focus or toggle form fields.
+ */
+static char *handle_form(WebKitDOMElement *elem)
+{
+    char *type;
+    gboolean click = FALSE, toggle = FALSE;
+
+    if (WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(elem) || WEBKIT_DOM_IS_HTML_FRAME_ELEMENT(elem)) {
+        webkit_dom_element_focus(elem);
+        return g_strdup("DONE:");
+    }
+    if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(elem)) {
+        type   = webkit_dom_html_input_element_get_input_type(WEBKIT_DOM_HTML_INPUT_ELEMENT(elem));
+        toggle = type && (!g_ascii_strcasecmp(type, "radio")
+                || !g_ascii_strcasecmp(type, "checkbox"));
+        click  = type && (!g_ascii_strcasecmp(type, "submit")
+                || !g_ascii_strcasecmp(type, "reset")
+                || !g_ascii_strcasecmp(type, "button")
+                || !g_ascii_strcasecmp(type, "image"));
+        g_free(type);
+    } else if (!WEBKIT_DOM_IS_HTML_TEXT_AREA_ELEMENT(elem)
+            && !WEBKIT_DOM_IS_HTML_SELECT_ELEMENT(elem)) {
+        return NULL;
+    }
+
+    if (toggle || click) {
+        if (toggle) {
+            webkit_dom_element_focus(elem);
+        }
+        webkit_dom_html_element_click(WEBKIT_DOM_HTML_ELEMENT(elem));
+        return g_strdup("DONE:");
+    }
+
+    webkit_dom_element_focus(elem);
+    return g_strdup("INSERT:");
+}
+
+/**
+ * Perform the action of the hint mode on the fired element.
+ */
+static char *action(Hints *hints, WebKitDOMElement *elem)
+{
+    OpenData *od;
+    char *value, *result;
+
+    switch (hints->mode) {
+        case 'o':
+        case 't':
+            /* Open the element after the result was returned to the UI
+             * process to not block the dbus call. */
+            od       = g_slice_new(OpenData);
+            od->page = g_object_ref(hints->page);
+            od->elem = g_object_ref(elem);
+            g_idle_add(open_cb, od);
+            return g_strdup("DONE:");
+
+        case 'Y':
+            value = webkit_dom_node_get_text_content(WEBKIT_DOM_NODE(elem));
+            break;
+
+        default:
+            value = get_src(elem);
+            break;
+    }
+
+    result = g_strconcat("DATA:", value ? value : "", NULL);
+    g_free(value);
+
+    return result;
+}
+
+/**
+ * Navigate to the href of the element or click it if there is no href.
+ */
+static gboolean open_cb(gpointer data)
+{
+    OpenData *od = data;
+    JSGlobalContextRef ctx;
+    char *href, *uri;
+
+    href = webkit_dom_element_get_attribute(od->elem, "href");
+    if (href && *href && strcmp(href, "#")) {
+        /* Navigate the top window to the uri like the former hinting script
+         * did to not open links with target attribute in new windows. */
+        uri = get_src(od->elem);
+        ctx = webkit_frame_get_javascript_context_for_script_world(
+                webkit_web_page_get_main_frame(od->page),
+                webkit_script_world_get_default());
+        ext_util_js_set_location(ctx, uri);
+        g_free(uri);
+    } else {
+        webkit_dom_html_element_click(WEBKIT_DOM_HTML_ELEMENT(od->elem));
+    }
+    g_free(href);
+    g_object_unref(od->elem);
+    g_object_unref(od->page);
+    g_slice_free(OpenData, od);
+
+    return FALSE;
+}
+
+/**
+ * Creates a new hint with label for given element.
+ */
+static Hint *hint_new(WebKitDOMDocument *doc, WebKitDOMElement *elem)
+{
+    WebKitDOMClientRectList *rects;
+    WebKitDOMClientRect *rect;
+    Hint *hint;
+    double left = 0, top = 0;
+    char *style;
+
+    hint        = g_slice_new0(Hint);
+    hint->elem  = g_object_ref(elem);
+    hint->label = g_object_ref(webkit_dom_document_create_element(doc, "span", NULL));
+    hint->text  = get_text(elem, &hint->show_text);
+    hint->ltext = g_utf8_strdown(hint->text ? hint->text : "", -1);
+    hint->state = HINT_NONE;
+
+    /* Place the label at the first box of the element. */
+    rects = webkit_dom_element_get_client_rects(elem);
+    if (rects && webkit_dom_client_rect_list_get_length(rects)) {
+        rect = webkit_dom_client_rect_list_item(rects, 0);
+        left = webkit_dom_client_rect_get_left(rect);
+        top  = webkit_dom_client_rect_get_top(rect);
+        g_object_unref(rect);
+    }
+    if (rects) {
+        g_object_unref(rects);
+    }
+
+    hint->top  = top;
+    hint->left = left;
+    /* The container is the containing block of the fixed positioned labels,
+     * so they are moved to their place relative to the viewport origin. */
+    style = g_strdup_printf("visibility:hidden;left:0;top:0;transform:translate(%dpx,%dpx)",
+            (int)MAX(left - 4, 0), (int)MAX(top - 4, 0));
+    webkit_dom_element_set_attribute(hint->label, HINT_ATTR, "label", NULL);
+    webkit_dom_element_set_attribute(hint->label, "style", style, NULL);
+    g_free(style);
+
+    return hint;
+}
+
+static void hint_free(Hint *hint)
+{
+    g_object_unref(hint->elem);
+    g_object_unref(hint->label);
+    g_free(hint->text);
+    g_free(hint->ltext);
+    g_free(hint->num);
+    g_free(hint->shown);
+    g_slice_free(Hint, hint);
+}
+
+/**
+ * Show the hint element colored with the hint label.
+ */
+static void hint_show(Hint *hint)
+{
+    GString *text;
+    char *type, *part;
+    gboolean extra = FALSE;
+
+    if (hint->state == HINT_NONE || hint->state == HINT_HIDDEN) {
+        set_style(hint->label, "visibility", "");
+        webkit_dom_element_set_attribute(hint->label, HINT_ATTR, "label", NULL);
+        webkit_dom_element_set_attribute(hint->elem, HINT_ATTR, "hint", NULL);
+        hint->state = HINT_VISIBLE;
+    }
+
+    /* Create the label with the hint number/letters. */
+    text = g_string_new(hint->num);
+    if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(hint->elem)) {
+        WebKitDOMHTMLInputElement *input = WEBKIT_DOM_HTML_INPUT_ELEMENT(hint->elem);
+        gboolean checked = webkit_dom_html_input_element_get_checked(input);
+
+        type = webkit_dom_html_input_element_get_input_type(input);
+        if (type && !g_ascii_strcasecmp(type, "checkbox")) {
+            /* U+2611 ballot box with check, U+2610 ballot box */
+            g_string_append(text, checked ? ": \xe2\x98\x91" : ": \xe2\x98\x90");
+            extra = TRUE;
+        } else if (type && !g_ascii_strcasecmp(type, "radio")) {
+            /* U+2299 circled dot operator, U+25CB white circle */
+            g_string_append(text, checked ? ": \xe2\x8a\x99" : ": \xe2\x97\x8b");
+            extra = TRUE;
+        }
+        g_free(type);
+    }
+    if (hint->show_text && hint->text && *hint->text) {
+        part = g_utf8_substring(hint->text, 0,
+                MIN(LABEL_MAX_LEN, g_utf8_strlen(hint->text, -1)));
+        g_string_append(text, extra ? " " : ": ");
+        g_string_append(text, part);
+        g_free(part);
+    }
+    /* Touch the label only if the text changed. */
+    if (g_strcmp0(hint->shown, text->str)) {
+        webkit_dom_node_set_text_content(WEBKIT_DOM_NODE(hint->label), text->str, NULL);
+        g_free(hint->shown);
+        hint->shown = g_string_free(text, FALSE);
+    } else {
+        g_string_free(text, TRUE);
+    }
+}
+
+/**
+ * Hide the hint label and remove coloring from hinted element.
+ */
+static void hint_hide(Hint *hint)
+{
+    if (hint->state == HINT_HIDDEN) {
+        return;
+    }
+    /* Keep the label prefix, so the label stays fixed positioned and hiding
+     * or showing it again does not change the layout of the container. */
+    set_style(hint->label, "visibility", "hidden");
+    webkit_dom_element_set_attribute(hint->label, HINT_ATTR, "label hidden", NULL);
+    webkit_dom_element_set_attribute(hint->elem, HINT_ATTR, "", NULL);
+    hint->state = HINT_HIDDEN;
+}
+
+/**
+ * Marks the element and label of a hint as focused.
+ */
+static void hint_focus(Hint *hint)
+{
+    webkit_dom_element_set_attribute(hint->label, HINT_ATTR, "label focus", NULL);
+    webkit_dom_element_set_attribute(hint->elem, HINT_ATTR, "hint focus", NULL);
+    hint->state = HINT_FOCUS;
+}
+
+/**
+ * Remove the focus mark from hint and label.
+ */
+static void hint_unfocus(Hint *hint)
+{
+    /* do not unfocus hidden hints */
+    if (hint->state != HINT_HIDDEN) {
+        webkit_dom_element_set_attribute(hint->label, HINT_ATTR, "label", NULL);
+        webkit_dom_element_set_attribute(hint->elem, HINT_ATTR, "hint", NULL);
+        hint->state = HINT_VISIBLE;
+    }
+}
+
+/**
+ * Retrieves the text of the hinted element used for filtering. For images
+ * the title or alt text is used and shown in the label too.
+ */
+static char *get_text(WebKitDOMElement *elem, gboolean *show_text)
+{
+    WebKitDOMElement *child;
+    WebKitDOMNode *option;
+    char *text, *type;
+    glong idx;
+
+    *show_text = FALSE;
+    child      = webkit_dom_element_get_first_element_child(elem);
+    if (WEBKIT_DOM_IS_HTML_IMAGE_ELEMENT(elem)) {
+        *show_text = TRUE;
+    } else if (child && WEBKIT_DOM_IS_HTML_IMAGE_ELEMENT(child)) {
+        text = webkit_dom_node_get_text_content(WEBKIT_DOM_NODE(elem));
+        if (!text || !*g_strstrip(text)) {
+            *show_text = TRUE;
+            elem       = child;
+        }
+        g_free(text);
+    }
+
+    if (*show_text) {
+        text = webkit_dom_html_element_get_title(WEBKIT_DOM_HTML_ELEMENT(elem));
+        if (!text || !*text) {
+            g_free(text);
+            text = webkit_dom_html_image_element_get_alt(WEBKIT_DOM_HTML_IMAGE_ELEMENT(elem));
+        }
+        return text;
+    }
+
+    if (WEBKIT_DOM_IS_HTML_INPUT_ELEMENT(elem)) {
+        WebKitDOMHTMLInputElement *input = WEBKIT_DOM_HTML_INPUT_ELEMENT(elem);
+
+        text = NULL;
+        type = webkit_dom_html_input_element_get_input_type(input);
+        if (type && !g_ascii_strcasecmp(type, "image")) {
+            text = webkit_dom_html_input_element_get_alt(input);
+        } else if (!type || g_ascii_strcasecmp(type, "password")) {
+            text       = webkit_dom_html_input_element_get_value(input);
+            *show_text = type && (!g_ascii_strcasecmp(type, "radio")
+                    || !g_ascii_strcasecmp(type, "checkbox"));
+        }
+        g_free(type);
+
+        return text;
+    }
+
+    if (WEBKIT_DOM_IS_HTML_SELECT_ELEMENT(elem)) {
+        idx = webkit_dom_html_select_element_get_selected_index(WEBKIT_DOM_HTML_SELECT_ELEMENT(elem));
+        if (idx >= 0) {
+            option = webkit_dom_html_select_element_item(WEBKIT_DOM_HTML_SELECT_ELEMENT(elem), idx);
+            if (option && WEBKIT_DOM_IS_HTML_OPTION_ELEMENT(option)) {
+                return webkit_dom_html_option_element_get_text(WEBKIT_DOM_HTML_OPTION_ELEMENT(option));
+            }
+        }
+        return NULL;
+    }
+
+    return webkit_dom_node_get_text_content(WEBKIT_DOM_NODE(elem));
+}
+
+/**
+ * Retrieves the url of given element.
+ */
+static char *get_src(WebKitDOMElement *elem)
+{
+    char *src = NULL;
+
+    if (WEBKIT_DOM_IS_HTML_ANCHOR_ELEMENT(elem)) {
+        src = webkit_dom_html_anchor_element_get_href(WEBKIT_DOM_HTML_ANCHOR_ELEMENT(elem));
+    } else if (WEBKIT_DOM_IS_HTML_AREA_ELEMENT(elem)) {
+        src = webkit_dom_html_area_element_get_href(WEBKIT_DOM_HTML_AREA_ELEMENT(elem));
+    } else if (WEBKIT_DOM_IS_HTML_IMAGE_ELEMENT(elem)) {
+        src = webkit_dom_html_image_element_get_src(WEBKIT_DOM_HTML_IMAGE_ELEMENT(elem));
+    } else if (WEBKIT_DOM_IS_HTML_IFRAME_ELEMENT(elem)) {
+        src = webkit_dom_html_iframe_element_get_src(WEBKIT_DOM_HTML_IFRAME_ELEMENT(elem));
+    }
+    if (src && *src) {
+        return src;
+    }
+    g_free(src);
+
+    /* Fall back to the attributes for elements without href or src
+     * property. */
+    src = webkit_dom_element_get_attribute(elem, "href");
+    if (src && *src) {
+        return src;
+    }
+    g_free(src);
+    src = webkit_dom_element_get_attribute(elem, "src");
+
+    return src ? src : g_strdup("");
+}
+
+/**
+ * Checks if given element is in the viewport and visible.
+ */
+static gboolean is_visible(WebKitDOMElement *elem, WebKitDOMDOMWindow *win,
+        const Offsets *offsets)
+{
+    WebKitDOMClientRect *rect;
+    WebKitDOMCSSStyleDeclaration *style;
+    double top, right, bottom, left, width, height;
+    char *display, *visibility, *text;
+    gboolean visible, named;
+
+    rect = webkit_dom_element_get_bounding_client_rect(elem);
+    if (!rect) {
+        return FALSE;
+    }
+    top    = webkit_dom_client_rect_get_top(rect);
+    right  = webkit_dom_client_rect_get_right(rect);
+    bottom = webkit_dom_client_rect_get_bottom(rect);
+    left   = webkit_dom_client_rect_get_left(rect);
+    width  = webkit_dom_client_rect_get_width(rect);
+    height = webkit_dom_client_rect_get_height(rect);
+    g_object_unref(rect);
+
+    if (top >= offsets->bottom || bottom <= offsets->top
+            || left >= offsets->right || right <= offsets->left) {
+        return FALSE;
+    }
+
+    /* Elements without size like links around floating images may still be
+     * visible by their children. */
+    if (!width || !height) {
+        text  = webkit_dom_node_get_text_content(WEBKIT_DOM_NODE(elem));
+        named = !(text && *text) && webkit_dom_element_has_attribute(elem, "name");
+        g_free(text);
+        if (!named && !has_visible_child(elem, win, offsets)) {
+            return FALSE;
+        }
+    }
+
+    style = webkit_dom_dom_window_get_computed_style(win, elem, NULL);
+    if (!style) {
+        return FALSE;
+    }
+    display    = webkit_dom_css_style_declaration_get_property_value(style, "display");
+    visibility = webkit_dom_css_style_declaration_get_property_value(style, "visibility");
+    visible    = g_strcmp0(display, "none") && !g_strcmp0(visibility, "visible");
+    g_free(display);
+    g_free(visibility);
+    g_object_unref(style);
+
+    return visible;
+}
+
+static gboolean has_visible_child(WebKitDOMElement *elem,
+        WebKitDOMDOMWindow *win, const Offsets *offsets)
+{
+    WebKitDOMElement *child;
+    WebKitDOMCSSStyleDeclaration *style;
+    char *value;
+    gboolean floating;
+
+    for (child = webkit_dom_element_get_first_element_child(elem);
+            child;
+            child = webkit_dom_element_get_next_element_sibling(child)) {
+        style = webkit_dom_element_get_style(child);
+        if (!style) {
+            continue;
+        }
+        value    = webkit_dom_css_style_declaration_get_property_value(style, "float");
+        floating = g_strcmp0(value, "none");
+        g_free(value);
+        g_object_unref(style);
+
+        if (floating && is_visible(child, win, offsets)) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * Checks if all the given lowercased tokens are found in text.
+ */
+static gboolean match_text(char **tokens, const char *text)
+{
+    for (; *tokens; tokens++) {
+        if (**tokens && !strstr(text, *tokens)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void mouse_event(WebKitDOMElement *elem, const char *type)
+{
+    WebKitDOMDocument *doc;
+    WebKitDOMDOMWindow *win;
+    WebKitDOMEvent *event;
+
+    doc   = webkit_dom_node_get_owner_document(WEBKIT_DOM_NODE(elem));
+    event = webkit_dom_document_create_event(doc, "MouseEvents", NULL);
+    if (!event) {
+        return;
+    }
+    win = webkit_dom_document_get_default_view(doc);
+    webkit_dom_mouse_event_init_mouse_event(WEBKIT_DOM_MOUSE_EVENT(event),
+            type, TRUE, TRUE, win, 0, 0, 0, 0, 0,
+            FALSE, FALSE, FALSE, FALSE, 0, NULL);
+    webkit_dom_event_target_dispatch_event(WEBKIT_DOM_EVENT_TARGET(elem), event, NULL);
+
+    g_object_unref(event);
+    if (win) {
+        g_object_unref(win);
+    }
+}
+
+/**
+ * Set the inline style property of given element. An empty value removes the
+ * property.
+ */
+static void set_style(WebKitDOMElement *elem, const char *property,
+        const char *value)
+{
+    WebKitDOMCSSStyleDeclaration *style = webkit_dom_element_get_style(elem);
+
+    if (style) {
+        webkit_dom_css_style_declaration_set_property(style, property, value, "", NULL);
+        g_object_unref(style);
+    }
+}
+
+/**
+ * Prepares the labeler to generate the hint labels for count hints.
+ */
+static void labeler_init(Labeler *labeler, const char *keys,
+        gboolean same_length, guint count)
+{
+    int val, res, max = count;
+
+    labeler->keys   = keys;
+    labeler->len    = strlen(keys);
+    /* Don't consider the hint keys to be numeric in case the hint-keys='0'
+     * to avoid endless loop by attempt to use next hint key char later. */
+    labeler->num    = (keys[0] == '0' && labeler->len > 1) ? 1 : 0;
+    labeler->count  = labeler->num;
+    labeler->offset = 0;
+
+    /* We can generate same length labels if there is more than one hint
+     * key. */
+    if (!same_length || labeler->len <= 1) {
+        return;
+    }
+    if (labeler->num) {
+        labeler->offset = 1;
+        /* Increase starting point of hint numbers until there are enough
+         * available numbers. */
+        while (labeler->offset * (labeler->len - 1) < max) {
+            labeler->offset *= labeler->len;
+        }
+        labeler->offset--;
+    } else {
+        /* Find hint string length to describe all hints with same length.
+         * The offset-th hint string is the first one to use. */
+        res = val = 0;
+        while (val < max) {
+            res += val;
+            val  = val ? val * labeler->len : labeler->len;
+        }
+        labeler->offset = res;
+    }
+}
+
+/**
+ * Returns the next hint label. The returned string must be freed.
+ */
+static char *labeler_next(Labeler *labeler)
+{
+    GString *label = g_string_new(NULL);
+    int n          = labeler->count + labeler->offset;
+
+    do {
+        g_string_append_c(label, labeler->keys[n % labeler->len]);
+        n /= labeler->len;
+        if (!labeler->num) {
+            n--;
+        }
+    } while (n - labeler->num >= 0);
+    labeler->count++;
+
+    return g_strreverse(g_string_free(label, FALSE));
+}
+
+/**
+ * Retrieves the hintable elements of the document for the selector which may
+ * be within the viewport given by offsets. The returned array must be freed.
+ */
+static GPtrArray *index_query(Hints *hints, WebKitDOMDocument *doc,
+        WebKitDOMDOMWindow *win, const Offsets *offsets)
+{
+    DocIndex *di;
+    Index *index;
+    IndexEntry *entry;
+    GPtrArray *result;
+    double scroll_y, top, bottom;
+    guint lo, hi, mid, i;
+    int selector = hints->selector;
+
+    di = doc_index_get(hints->page, doc);
+    /* Documents of frames can't be observed by a MutationObserver. The
+     * mutation events slow down each change of the DOM, so they are only
+     * observed until the hints are cleared. */
+    if (!di->observer && !di->listening) {
+        doc_index_listen(di, TRUE);
+        hints->indexed = g_slist_prepend(hints->indexed, g_object_ref(doc));
+    }
+    doc_index_update(di);
+    if (!di->index[selector]) {
+        di->index[selector] = index_new(doc, selectors[selector].selector);
+        if (!di->index[selector]) {
+            return NULL;
+        }
+    }
+    index = di->index[selector];
+
+    /* Only the geometry must be checked again after the layout changed. */
+    if (!index->entries || index->generation != di->generation) {
+        index_measure(index, win);
+        index->generation = di->generation;
+    }
+
+    scroll_y = webkit_dom_dom_window_get_scroll_y(win);
+    top      = scroll_y + offsets->top;
+    bottom   = scroll_y + offsets->bottom;
+
+    /* Find the first entry that may reach into the viewport. */
+    lo = 0;
+    hi = index->entries->len;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (g_array_index(index->entries, IndexEntry, mid).top < top - index->max_height) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    result = g_ptr_array_new();
+    for (i = lo; i < index->entries->len; i++) {
+        entry = &g_array_index(index->entries, IndexEntry, i);
+        /* Stop at the first entry below the viewport. */
+        if (entry->top >= bottom) {
+            break;
+        }
+        if (entry->bottom > top) {
+            g_ptr_array_add(result, entry->elem);
+        }
+    }
+    for (i = 0; i < index->always->len; i++) {
+        g_ptr_array_add(result, g_ptr_array_index(index->always, i));
+    }
+
+    return result;
+}
+
+/**
+ * Retrieves the index of the document. On first call the events that may
+ * change the layout of the document are observed and the DOM of the main
+ * document is watched by a MutationObserver.
+ */
+static DocIndex *doc_index_get(WebKitWebPage *page, WebKitDOMDocument *doc)
+{
+    WebKitDOMEventTarget *target = WEBKIT_DOM_EVENT_TARGET(doc);
+    WebKitDOMDOMWindow *win;
+    DocIndex *di;
+
+    di = g_object_get_data(G_OBJECT(doc), INDEX_DATA);
+    if (di) {
+        return di;
+    }
+
+    di           = g_slice_new0(DocIndex);
+    di->doc      = doc;
+    di->inserted = g_ptr_array_new_with_free_func(g_object_unref);
+    di->changed  = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            g_object_unref, NULL);
+    g_object_set_data_full(G_OBJECT(doc), INDEX_DATA, di,
+            (GDestroyNotify)doc_index_free);
+
+    win = webkit_dom_document_get_default_view(doc);
+    if (win) {
+        webkit_dom_event_target_add_event_listener(WEBKIT_DOM_EVENT_TARGET(win),
+                "resize", G_CALLBACK(on_layout_change), FALSE, di);
+        g_object_unref(win);
+    }
+    /* Scrolled elements, loaded images and finished transitions move the
+     * elements within the document. The events do not bubble so they are
+     * observed in capture phase. */
+    webkit_dom_event_target_add_event_listener(target, "scroll",
+            G_CALLBACK(on_layout_change), TRUE, di);
+    webkit_dom_event_target_add_event_listener(target, "load",
+            G_CALLBACK(on_layout_change), TRUE, di);
+    webkit_dom_event_target_add_event_listener(target, "transitionend",
+            G_CALLBACK(on_layout_change), TRUE, di);
+    webkit_dom_event_target_add_event_listener(target, "animationend",
+            G_CALLBACK(on_layout_change), TRUE, di);
+
+    di->observer = ext_js_observe_mutations(page, doc, SELECTOR_ATTRS,
+            MAX_PENDING, (ExtJsMutationFunc)on_mutations, di);
+
+    return di;
+}
+
+static void doc_index_free(DocIndex *di)
+{
+    int i;
+
+    ext_js_observer_free(di->observer);
+    for (i = 0; i < G_N_ELEMENTS(selectors); i++) {
+        if (di->index[i]) {
+            index_free(di->index[i]);
+        }
+    }
+    g_ptr_array_free(di->inserted, TRUE);
+    g_hash_table_destroy(di->changed);
+    g_slice_free(DocIndex, di);
+}
+
+/**
+ * Apply the DOM changes recorded since the last update to the indices.
+ */
+static void doc_index_update(DocIndex *di)
+{
+    WebKitDOMNode *docnode = WEBKIT_DOM_NODE(di->doc);
+    WebKitDOMElement *elem;
+    GHashTableIter iter;
+    Index *index;
+    int i;
+    guint j;
+
+    for (i = 0; i < G_N_ELEMENTS(selectors); i++) {
+        if (!(index = di->index[i])) {
+            continue;
+        }
+        if (di->rebuild) {
+            index_free(index);
+            di->index[i] = NULL;
+            continue;
+        }
+
+        for (j = 0; j < di->inserted->len; j++) {
+            elem = g_ptr_array_index(di->inserted, j);
+            if (webkit_dom_node_contains(docnode, WEBKIT_DOM_NODE(elem))) {
+                index_add_subtree(index, elem, selectors[i].selector);
+            }
+        }
+
+        /* Elements may start or stop to match the selector if their
+         * attributes are changed. */
+        g_hash_table_iter_init(&iter, di->changed);
+        while (g_hash_table_iter_next(&iter, (gpointer*)&elem, NULL)) {
+            if (webkit_dom_node_contains(docnode, WEBKIT_DOM_NODE(elem))
+                    && webkit_dom_element_matches(elem, selectors[i].selector, NULL)) {
+                if (!g_hash_table_contains(index->members, elem)) {
+                    g_hash_table_add(index->members, g_object_ref(elem));
+                }
+            } else {
+                g_hash_table_remove(index->members, elem);
+            }
+        }
+
+        if (di->removed) {
+            g_hash_table_foreach_remove(index->members, (GHRFunc)is_detached, di->doc);
+        }
+    }
+    doc_index_clear_pending(di);
+}
+
+/**
+ * Starts or stops to record the DOM changes by the mutation events for
+ * documents without MutationObserver.
+ */
+static void doc_index_listen(DocIndex *di, gboolean listen)
+{
+    WebKitDOMEventTarget *target;
+    static const char *events[] = {
+        "DOMNodeInserted", "DOMNodeRemoved", "DOMSubtreeModified"
+    };
+    int i;
+
+    if (!di || di->listening == listen) {
+        return;
+    }
+    target = WEBKIT_DOM_EVENT_TARGET(di->doc);
+    for (i = 0; i < G_N_ELEMENTS(events); i++) {
+        if (listen) {
+            webkit_dom_event_target_add_event_listener(target, events[i],
+                    G_CALLBACK(on_dom_change), TRUE, di);
+        } else {
+            webkit_dom_event_target_remove_event_listener(target, events[i],
+                    G_CALLBACK(on_dom_change), TRUE);
+        }
+    }
+    di->listening = listen;
+
+    /* The changes until the next hinting are not seen. */
+    if (!listen) {
+        doc_index_clear_pending(di);
+        di->rebuild = TRUE;
+        di->generation++;
+    }
+}
+
+static void doc_index_clear_pending(DocIndex *di)
+{
+    g_ptr_array_set_size(di->inserted, 0);
+    g_hash_table_remove_all(di->changed);
+    di->removed = FALSE;
+    di->rebuild = FALSE;
+}
+
+static void on_layout_change(WebKitDOMEventTarget *target,
+        WebKitDOMEvent *event, DocIndex *di)
+{
+    /* Scrolling of the document itself does not change the position of the
+     * elements within the document. The document is the target of its own
+     * scroll event, other scrolled elements are seen in capture phase. */
+    if (webkit_dom_event_get_event_phase(event) == 2 && WEBKIT_DOM_IS_DOCUMENT(target)) {
+        return;
+    }
+    di->generation++;
+}
+
+/**
+ * Returns TRUE if there is an index that the DOM changes must be recorded
+ * for.
+ */
+static gboolean doc_index_tracks(DocIndex *di)
+{
+    int i;
+
+    /* Nothing to record if all indices are rebuilt anyway or there is no
+     * index yet. */
+    if (di->rebuild) {
+        return FALSE;
+    }
+    for (i = 0; i < G_N_ELEMENTS(selectors) && !di->index[i]; i++);
+
+    return i < G_N_ELEMENTS(selectors);
+}
+
+/**
+ * Records an inserted subtree root or an element with changed attributes to
+ * be applied to the indices on next hinting.
+ */
+static void doc_index_record(DocIndex *di, WebKitDOMEventTarget *node,
+        gboolean inserted)
+{
+    if (inserted) {
+        g_ptr_array_add(di->inserted, g_object_ref(node));
+    } else if (!g_hash_table_contains(di->changed, node)) {
+        g_hash_table_add(di->changed, g_object_ref(node));
+    }
+
+    /* Applying many changes one by one is slower than to build the indices
+     * from scratch. */
+    if (di->inserted->len + g_hash_table_size(di->changed) > MAX_PENDING) {
+        doc_index_clear_pending(di);
+        di->rebuild = TRUE;
+    }
+}
+
+/**
+ * Records the DOM changes of the main document reported by the
+ * MutationObserver.
+ */
+static void on_mutations(guint changes, GPtrArray *added, GPtrArray *changed,
+        DocIndex *di)
+{
+    guint i;
+
+    /* Any change of the DOM may move the elements. */
+    di->generation++;
+
+    if (changes & EXT_JS_MUTATION_REMOVED) {
+        di->removed = TRUE;
+    }
+    if (!(changes & (EXT_JS_MUTATION_ADDED | EXT_JS_MUTATION_ATTRIBUTE))
+            || !doc_index_tracks(di)) {
+        return;
+    }
+
+    /* Too many changes or the elements are not known. */
+    if (!added || !changed) {
+        doc_index_clear_pending(di);
+        di->rebuild = TRUE;
+        return;
+    }
+    for (i = 0; i < added->len && !di->rebuild; i++) {
+        doc_index_record(di, g_ptr_array_index(added, i), TRUE);
+    }
+    for (i = 0; i < changed->len && !di->rebuild; i++) {
+        doc_index_record(di, g_ptr_array_index(changed, i), FALSE);
+    }
+}
+
+/**
+ * Record the changed DOM nodes to apply them to the indices on next hinting.
+ */
+static void on_dom_change(WebKitDOMEventTarget *target,
+        WebKitDOMEvent *event, DocIndex *di)
+{
+    WebKitDOMEventTarget *node;
+    char *type;
+
+    if (own_changes) {
+        return;
+    }
+    /* Any change of the DOM may move the elements. */
+    di->generation++;
+
+    if (!doc_index_tracks(di)) {
+        return;
+    }
+
+    node = webkit_dom_event_get_target(event);
+    if (!node || !WEBKIT_DOM_IS_ELEMENT(node)) {
+        return;
+    }
+
+    type = webkit_dom_event_get_event_type(event);
+    if (!g_strcmp0(type, "DOMNodeRemoved")) {
+        di->removed = TRUE;
+    } else {
+        doc_index_record(di, node, !g_strcmp0(type, "DOMNodeInserted"));
+    }
+    g_free(type);
+}
+
+/**
+ * Creates a new index with all elements of the document matching selector.
+ * Together with the following index_measure() this walks all the members
+ * once, which is about the cost of a hinting without index. It is paid on
+ * the first hinting of the document and after the index is rebuilt.
+ */
+static Index *index_new(WebKitDOMDocument *doc, const char *selector)
+{
+    WebKitDOMNodeList *list;
+    Index *index;
+    gulong i, len;
+
+    list = webkit_dom_document_query_selector_all(doc, selector, NULL);
+    if (!list) {
+        return NULL;
+    }
+
+    index          = g_slice_new0(Index);
+    index->members = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+            g_object_unref, NULL);
+
+    len = webkit_dom_node_list_get_length(list);
+    for (i = 0; i < len; i++) {
+        g_hash_table_add(index->members, g_object_ref(webkit_dom_node_list_item(list, i)));
+    }
+    g_object_unref(list);
+
+    return index;
+}
+
+static void index_free(Index *index)
+{
+    guint i;
+
+    if (index->entries) {
+        for (i = 0; i < index->entries->len; i++) {
+            g_object_unref(g_array_index(index->entries, IndexEntry, i).elem);
+        }
+        g_array_free(index->entries, TRUE);
+        g_ptr_array_free(index->always, TRUE);
+    }
+    g_hash_table_destroy(index->members);
+    g_slice_free(Index, index);
+}
+
+/**
+ * Adds root and all its descendants that match selector to the index.
+ */
+static void index_add_subtree(Index *index, WebKitDOMElement *root,
+        const char *selector)
+{
+    WebKitDOMNodeList *list;
+    WebKitDOMNode *node;
+    gulong i, len;
+
+    if (webkit_dom_element_matches(root, selector, NULL)
+            && !g_hash_table_contains(index->members, root)) {
+        g_hash_table_add(index->members, g_object_ref(root));
+    }
+
+    list = webkit_dom_element_query_selector_all(root, selector, NULL);
+    if (!list) {
+        return;
+    }
+    len = webkit_dom_node_list_get_length(list);
+    for (i = 0; i < len; i++) {
+        node = webkit_dom_node_list_item(list, i);
+        if (!g_hash_table_contains(index->members, node)) {
+            g_hash_table_add(index->members, g_object_ref(node));
+        }
+    }
+    g_object_unref(list);
+}
+
+static gboolean is_detached(WebKitDOMElement *elem, gpointer value,
+        WebKitDOMDocument *doc)
+{
+    return !webkit_dom_node_contains(WEBKIT_DOM_NODE(doc), WEBKIT_DOM_NODE(elem));
+}
+
+/**
+ * Measure the position of the index members within the document. This
+ * forces a single layout and is repeated only after the layout changed.
+ */
+static void index_measure(Index *index, WebKitDOMDOMWindow *win)
+{
+    WebKitDOMElement *elem;
+    WebKitDOMClientRect *rect;
+    GHashTableIter iter;
+    GHashTable *memo;
+    IndexEntry entry;
+    double scroll_y, view_height, top, bottom, width;
+    guint i;
+
+    if (index->entries) {
+        for (i = 0; i < index->entries->len; i++) {
+            g_object_unref(g_array_index(index->entries, IndexEntry, i).elem);
+        }
+        g_array_set_size(index->entries, 0);
+        g_ptr_array_set_size(index->always, 0);
+    } else {
+        index->entries = g_array_new(FALSE, FALSE, sizeof(IndexEntry));
+        index->always  = g_ptr_array_new_with_free_func(g_object_unref);
+    }
+    index->max_height = 0;
+
+    scroll_y    = webkit_dom_dom_window_get_scroll_y(win);
+    view_height = webkit_dom_dom_window_get_inner_height(win);
+    memo        = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    g_hash_table_iter_init(&iter, index->members);
+    while (g_hash_table_iter_next(&iter, (gpointer*)&elem, NULL)) {
+        rect = webkit_dom_element_get_bounding_client_rect(elem);
+        if (!rect) {
+            continue;
+        }
+        top    = webkit_dom_client_rect_get_top(rect);
+        bottom = webkit_dom_client_rect_get_bottom(rect);
+        width  = webkit_dom_client_rect_get_width(rect);
+        g_object_unref(rect);
+
+        if (!width || bottom <= top || bottom - top > view_height
+                || is_out_of_flow(elem, win, memo)) {
+            g_ptr_array_add(index->always, g_object_ref(elem));
+            continue;
+        }
+
+        entry.elem        = g_object_ref(elem);
+        entry.top         = top + scroll_y;
+        entry.bottom      = bottom + scroll_y;
+        index->max_height = MAX(index->max_height, bottom - top);
+        g_array_append_val(index->entries, entry);
+    }
+    g_hash_table_destroy(memo);
+
+    g_array_sort(index->entries, compare_entries);
+}
+
+/**
+ * Checks if the position of the element within the document may change on
+ * scrolling or if the element is hidden. Such elements have no offset parent
+ * or a fixed or sticky one.
+ *
+ * @memo: Hash table to remember the result for the offset parents.
+ */
+static gboolean is_out_of_flow(WebKitDOMElement *elem, WebKitDOMDOMWindow *win,
+        GHashTable *memo)
+{
+    WebKitDOMElement *parent;
+    WebKitDOMCSSStyleDeclaration *style;
+    gpointer value;
+    char *position;
+
+    while ((parent = webkit_dom_element_get_offset_parent(elem))) {
+        if (WEBKIT_DOM_IS_HTML_BODY_ELEMENT(parent)) {
+            return FALSE;
+        }
+        if (!g_hash_table_lookup_extended(memo, parent, NULL, &value)) {
+            position = NULL;
+            style    = webkit_dom_dom_window_get_computed_style(win, parent, NULL);
+            if (style) {
+                position = webkit_dom_css_style_declaration_get_property_value(style, "position");
+                g_object_unref(style);
+            }
+            value = GINT_TO_POINTER(!g_strcmp0(position, "fixed")
+                    || !g_strcmp0(position, "sticky")
+                    || !g_strcmp0(position, "-webkit-sticky"));
+            g_free(position);
+            g_hash_table_insert(memo, parent, value);
+        }
+        if (GPOINTER_TO_INT(value)) {
+            return TRUE;
+        }
+        elem = parent;
+    }
+
+    /* Fixed elements and elements within hidden ones have no offset parent. */
+    return TRUE;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    double ta = ((const IndexEntry*)a)->top, tb = ((const IndexEntry*)b)->top;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+/**
+ * Order hints from top to bottom and left to right.
+ */
+static int compare_hints(const void *a, const void *b)
+{
+    const Hint *ha = *(Hint**)a, *hb = *(Hint**)b;
+
+    if (ha->top != hb->top) {
+        return ha->top < hb->top ? -1 : 1;
+    }
+    return ha->left < hb->left ? -1 : ha->left > hb->left;
+}
@@ -0,0 +1,35 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _EXT_HINTS_H
+#define _EXT_HINTS_H
+
+#include <glib.h>
+#include <webkit2/webkit-web-extension.h>
+
+char *ext_hints_init(WebKitWebPage *page, char mode, gboolean keep_open,
+        guint max_hints, const char *keys, gboolean follow_last,
+        gboolean keys_same_length);
+char *ext_hints_filter(WebKitWebPage *page, const char *text);
+char *ext_hints_update(WebKitWebPage *page, const char *key);
+char *ext_hints_focus(WebKitWebPage *page, gboolean back);
+char *ext_hints_fire(WebKitWebPage *page);
+void ext_hints_clear(WebKitWebPage *page);
+
+#endif /* end of include guard: _EXT_HINTS_H */
@@ -0,0 +1,581 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <glib.h>
+#include <JavaScriptCore/JavaScript.h>
+#include <webkit2/webkit-web-extension.h>
+#include <webkitdom/webkitdom.h>
+
+#include "ext-js.h"
+#include "ext-main.h"
+#include "ext-util.h"
+
+#define JS_DATA    "vimb-js"
+#define MAX_PARAMS 3
+
+/* The functions that can be called by the UI process. They are compiled
+ * once per JavaScript context of the page. */
+static const struct {
+    const char *name;
+    guint      paramcount;
+    const char *params[MAX_PARAMS];
+    const char *body;
+} functions[VB_JS_LAST] = {
+    /* vbscroll() is injected by the UI process as user script. */
+    [VB_JS_SCROLL] = {"vimb_scroll", 3, {"mode", "step", "count"},
+        "return vbscroll(mode, step, count);"},
+    [VB_JS_SCROLL_TO] = {"vimb_scroll_to", 1, {"top"},
+        "window.scroll(window.screenLeft, top);"},
+    [VB_JS_INCREMENT_URI] = {"vimb_increment_uri", 1, {"count"},
+        "var on, nn, m = location.href.match(/(.*?)(\\d+)(\\D*)$/);"
+        "if (m) {"
+        "    on = m[2];"
+        "    nn = String(Math.max(parseInt(on) + count, 0));"
+        /* keep prepending zeros */
+        "    if (/^0/.test(on)) {"
+        "        while (nn.length < on.length) {"
+        "            nn = '0' + nn;"
+        "        }"
+        "    }"
+        "    m[2] = nn;"
+        "    location.href = m.slice(1).join('');"
+        "}"},
+    [VB_JS_BLUR_ACTIVE] = {"vimb_blur_active", 0, {NULL},
+        "document.activeElement.blur();"},
+    [VB_JS_CLICK_SELECTION] = {"vimb_click_selection", 0, {NULL},
+        "getSelection().anchorNode.parentNode.click();"},
+    [VB_JS_INPUT_ENTER] = {"vimb_input_enter", 0, {NULL},
+        "window.vimb_input_mode_element = document.activeElement;"},
+    [VB_JS_INPUT_LEAVE] = {"vimb_input_leave", 0, {NULL},
+        "vimb_input_mode_element.blur();"},
+    [VB_JS_INPUT_VALUE] = {"vimb_input_value", 0, {NULL},
+        "return vimb_input_mode_element.value;"},
+    [VB_JS_INPUT_ID] = {"vimb_input_id", 0, {NULL},
+        "return vimb_input_mode_element.id;"},
+    [VB_JS_EDITOR_MAP_SET] = {"vimb_editor_map_set", 1, {"key"},
+        "if (typeof(window.vimb_editor_map) !== 'object') {"
+        "    window.vimb_editor_map = new Map;"
+        "}"
+        "vimb_editor_map.set(key, vimb_input_mode_element);"},
+    [VB_JS_EDITOR_MAP_FOCUS] = {"vimb_editor_map_focus", 1, {"key"},
+        "vimb_editor_map.get(key).disabled = false;"
+        "vimb_editor_map.get(key).focus();"},
+    [VB_JS_EDITOR_SET_BY_ID] = {"vimb_editor_set_by_id", 2, {"id", "text"},
+        "document.getElementById(id).value = text;"},
+    [VB_JS_EDITOR_SET_BY_KEY] = {"vimb_editor_set_by_key", 2, {"key", "text"},
+        "vimb_editor_map.get(key).value = text;"},
+};
+
+/* Installs a MutationObserver on the document that calls notify with the
+ * EXT_JS_MUTATION_* flags of the changes, the roots of the added subtrees and
+ * the elements with changed attributes. The element lists are null if there
+ * are more than max of them. The changes within the hint label container and
+ * of the hint attribute are done by vimb itself and ignored. */
+static const char observe_body[] =
+    "function own(n) {"
+    "    var e = n.nodeType == 1 ? n : n.parentElement;"
+    "    return e && e.closest('[vimbhint=container]');"
+    "}"
+    "attributes = attributes.split(' ');"
+    "var o = new MutationObserver(function(records) {"
+    "    var r, n, i, j, changes = 0, added = [], changed = [];"
+    "    for (i = 0; i < records.length; i++) {"
+    "        r = records[i];"
+    "        if (own(r.target) || r.attributeName == 'vimbhint') {"
+    "            continue;"
+    "        }"
+    "        if (r.type == 'childList') {"
+    "            for (j = 0; j < r.addedNodes.length; j++) {"
+    "                n = r.addedNodes[j];"
+    "                if (n.nodeType != 1) {"
+    "                    changes |= 8;"
+    "                } else if (!own(n)) {"
+    "                    changes |= 1;"
+    "                    added.push(n);"
+    "                }"
+    "            }"
+    "            for (j = 0; j < r.removedNodes.length; j++) {"
+    "                if (!own(r.removedNodes[j])) {"
+    "                    changes |= 2;"
+    "                    break;"
+    "                }"
+    "            }"
+    "        } else if (r.type == 'attributes' && attributes.indexOf(r.attributeName) >= 0) {"
+    "            changes |= 4;"
+    "            changed.push(r.target);"
+    "        } else {"
+    "            changes |= 8;"
+    "        }"
+    "    }"
+    "    if (added.length + changed.length > max) {"
+    "        added = changed = null;"
+    "    }"
+    "    if (changes) {"
+    "        notify(changes, added, changed);"
+    "    }"
+    "});"
+    "o.observe(document, {childList: true, attributes: true, characterData: true, subtree: true});"
+    "return o;";
+
+struct JsObserver {
+#if WEBKIT_CHECK_VERSION(2, 22, 0)
+    JSCValue           *observer;   /* the MutationObserver */
+#else
+    JSGlobalContextRef ctx;
+    JSObjectRef        notify;      /* has the JsObserver as private data */
+    JSObjectRef        observer;    /* the MutationObserver */
+#endif
+    ExtJsMutationFunc  func;        /* NULL after the observer was freed */
+    gpointer           data;
+};
+
+/* Compiled functions of the JavaScript context of the page's main frame. */
+typedef struct {
+    JSGlobalContextRef ctx;
+    JSObjectRef        funcs[VB_JS_LAST];
+} JsCache;
+
+static JSObjectRef get_function(WebKitWebPage *page, JSGlobalContextRef ctx,
+        guint func, JSValueRef *exception);
+static JSValueRef variant_to_js(JSContextRef ctx, GVariant *value);
+static void cache_clear(JsCache *cache);
+static void cache_free(JsCache *cache);
+#if WEBKIT_CHECK_VERSION(2, 22, 0)
+static void on_mutations(guint changes, JSCValue *added, JSCValue *changed,
+        JsObserver *obs);
+static GPtrArray *js_elements(JSCValue *array);
+static void observer_destroy(JsObserver *obs);
+#else
+static JSValueRef on_mutations(JSContextRef ctx, JSObjectRef function,
+        JSObjectRef this, size_t argc, const JSValueRef argv[],
+        JSValueRef *exception);
+#endif
+
+
+/**
+ * Calls the function func of the page with the values of the tuple args as
+ * arguments. Returns TRUE if the function returned without exception. The
+ * return value or the exception is written as string to result, if result
+ * is not NULL.
+ */
+gboolean ext_js_call(WebKitWebPage *page, guint func, GVariant *args,
+        char **result)
+{
+    JSGlobalContextRef ctx;
+    JSObjectRef function;
+    JSValueRef argv[MAX_PARAMS], ret = NULL, exc = NULL;
+    gsize i, argc;
+
+    if (func >= VB_JS_LAST) {
+        if (result) {
+            *result = g_strdup_printf("Unknown function %u", func);
+        }
+        return FALSE;
+    }
+
+    ctx = webkit_frame_get_javascript_context_for_script_world(
+            webkit_web_page_get_main_frame(page),
+            webkit_script_world_get_default());
+
+    function = get_function(page, ctx, func, &exc);
+    if (function) {
+        /* Arguments missing in args are passed as undefined. */
+        argc = MIN(g_variant_n_children(args), MAX_PARAMS);
+        for (i = 0; i < argc; i++) {
+            GVariant *value = g_variant_get_child_value(args, i);
+            argv[i] = variant_to_js(ctx, value);
+            g_variant_unref(value);
+        }
+        ret = JSObjectCallAsFunction(ctx, function, NULL, argc, argv, &exc);
+    }
+
+    if (result) {
+        *result = (exc || ret) ? ext_util_js_ref_to_string(ctx, exc ? exc : ret) : NULL;
+    }
+
+    return !exc;
+}
+
+/**
+ * Drop the compiled functions of the page, for example because a new
+ * document was loaded.
+ */
+void ext_js_clear(WebKitWebPage *page)
+{
+    JsCache *cache = g_object_get_data(G_OBJECT(page), JS_DATA);
+
+    if (cache) {
+        cache_clear(cache);
+    }
+}
+
+/**
+ * Observes the DOM changes of the document with a MutationObserver. Other
+ * than the DOM mutation events this does not slow down each change of the
+ * page, because the changes are reported in batches after the scripts of
+ * the page ran. Only the document of the main frame can be observed, for
+ * other documents NULL is returned.
+ *
+ * The changed elements can only be handed over with WebKit 2.22 or newer.
+ * Before that func gets only the flags of the changes.
+ *
+ * @attributes: Space separated names of attributes reported by
+ *              EXT_JS_MUTATION_ATTRIBUTE.
+ * @max_nodes:  Maximum number of elements given to func in one call. If
+ *              there are more, func gets NULL instead of the elements.
+ */
+#if WEBKIT_CHECK_VERSION(2, 22, 0)
+JsObserver *ext_js_observe_mutations(WebKitWebPage *page,
+        WebKitDOMDocument *doc, const char *attributes, guint max_nodes,
+        ExtJsMutationFunc func, gpointer data)
+{
+    JSCContext *ctx;
+    JSCValue *function, *notify;
+    JsObserver *obs;
+    char *code;
+
+    if (doc != webkit_web_page_get_dom_document(page)) {
+        return NULL;
+    }
+
+    ctx = webkit_frame_get_js_context_for_script_world(
+            webkit_web_page_get_main_frame(page),
+            webkit_script_world_get_default());
+
+    code     = g_strconcat("(function(notify, attributes, max) {", observe_body, "})", NULL);
+    function = jsc_context_evaluate(ctx, code, -1);
+    g_free(code);
+
+    obs       = g_slice_new0(JsObserver);
+    obs->func = func;
+    obs->data = data;
+    /* The MutationObserver holds the notify function until it is collected,
+     * so the JsObserver is freed together with the function. */
+    notify = jsc_value_new_function(ctx, NULL, G_CALLBACK(on_mutations), obs,
+            (GDestroyNotify)observer_destroy, G_TYPE_NONE, 3,
+            G_TYPE_UINT, JSC_TYPE_VALUE, JSC_TYPE_VALUE);
+    if (jsc_value_is_function(function)) {
+        obs->observer = jsc_value_function_call(function,
+                JSC_TYPE_VALUE, notify, G_TYPE_STRING, attributes,
+                G_TYPE_UINT, max_nodes, G_TYPE_NONE);
+    }
+    g_object_unref(notify);
+    g_object_unref(function);
+
+    /* The page may have replaced MutationObserver. */
+    if (!obs->observer || !jsc_value_is_object(obs->observer)) {
+        jsc_context_clear_exception(ctx);
+        g_clear_object(&obs->observer);
+        obs->func = NULL;
+        obs       = NULL;
+    }
+    g_object_unref(ctx);
+
+    return obs;
+}
+
+/**
+ * Disconnects the MutationObserver. The callback is not called anymore.
+ */
+void ext_js_observer_free(JsObserver *obs)
+{
+    JSCValue *result;
+
+    if (!obs) {
+        return;
+    }
+    obs->func = NULL;
+
+    result = jsc_value_object_invoke_method(obs->observer, "disconnect", G_TYPE_NONE);
+    g_object_unref(result);
+    g_clear_object(&obs->observer);
+}
+#else
+JsObserver *ext_js_observe_mutations(WebKitWebPage *page,
+        WebKitDOMDocument *doc, const char *attributes, guint max_nodes,
+        ExtJsMutationFunc func, gpointer data)
+{
+    static JSClassRef class = NULL;
+    JSClassDefinition def = kJSClassDefinitionEmpty;
+    JSGlobalContextRef ctx;
+    JSStringRef name, body, params[3], str;
+    JSObjectRef function;
+    JSValueRef argv[3], ret = NULL;
+    JsObserver *obs;
+    guint i;
+
+    if (doc != webkit_web_page_get_dom_document(page)) {
+        return NULL;
+    }
+    if (!class) {
+        def.className      = "VimbMutationNotify";
+        def.callAsFunction = on_mutations;
+        class              = JSClassCreate(&def);
+    }
+
+    ctx = webkit_frame_get_javascript_context_for_script_world(
+            webkit_web_page_get_main_frame(page),
+            webkit_script_world_get_default());
+
+    name      = JSStringCreateWithUTF8CString("vimb_observe_mutations");
+    body      = JSStringCreateWithUTF8CString(observe_body);
+    params[0] = JSStringCreateWithUTF8CString("notify");
+    params[1] = JSStringCreateWithUTF8CString("attributes");
+    params[2] = JSStringCreateWithUTF8CString("max");
+    function  = JSObjectMakeFunction(ctx, name, 3, params, body, NULL, 1, NULL);
+    JSStringRelease(name);
+    JSStringRelease(body);
+    for (i = 0; i < 3; i++) {
+        JSStringRelease(params[i]);
+    }
+
+    obs       = g_slice_new0(JsObserver);
+    obs->func = func;
+    obs->data = data;
+    if (function) {
+        obs->notify = JSObjectMake(ctx, class, obs);
+        str         = JSStringCreateWithUTF8CString(attributes);
+        argv[0]     = obs->notify;
+        argv[1]     = JSValueMakeString(ctx, str);
+        argv[2]     = JSValueMakeNumber(ctx, max_nodes);
+        JSStringRelease(str);
+        ret = JSObjectCallAsFunction(ctx, function, NULL, 3, argv, NULL);
+    }
+    /* The page may have replaced MutationObserver. */
+    if (!ret || !JSValueIsObject(ctx, ret)) {
+        if (obs->notify) {
+            JSObjectSetPrivate(obs->notify, NULL);
+        }
+        g_slice_free(JsObserver, obs);
+        return NULL;
+    }
+
+    obs->ctx      = JSGlobalContextRetain(ctx);
+    obs->observer = JSValueToObject(ctx, ret, NULL);
+    JSValueProtect(ctx, obs->notify);
+    JSValueProtect(ctx, obs->observer);
+
+    return obs;
+}
+
+/**
+ * Disconnects the MutationObserver. The callback is not called anymore.
+ */
+void ext_js_observer_free(JsObserver *obs)
+{
+    JSStringRef name;
+    JSValueRef disconnect;
+
+    if (!obs) {
+        return;
+    }
+    JSObjectSetPrivate(obs->notify, NULL);
+
+    name       = JSStringCreateWithUTF8CString("disconnect");
+    disconnect = JSObjectGetProperty(obs->ctx, obs->observer, name, NULL);
+    JSStringRelease(name);
+    if (disconnect && JSValueIsObject(obs->ctx, disconnect)) {
+        JSObjectCallAsFunction(obs->ctx, JSValueToObject(obs->ctx, disconnect, NULL),
+                obs->observer, 0, NULL, NULL);
+    }
+
+    JSValueUnprotect(obs->ctx, obs->notify);
+    JSValueUnprotect(obs->ctx, obs->observer);
+    JSGlobalContextRelease(obs->ctx);
+    g_slice_free(JsObserver, obs);
+}
+#endif
+
+/**
+ * Returns the compiled function for the context. The function is compiled on
+ * the first call in the context.
+ */
+static JSObjectRef get_function(WebKitWebPage *page, JSGlobalContextRef ctx,
+        guint func, JSValueRef *exception)
+{
+    JsCache *cache;
+    JSStringRef name, body, params[MAX_PARAMS];
+    JSObjectRef function;
+    guint i;
+
+    cache = g_object_get_data(G_OBJECT(page), JS_DATA);
+    if (!cache) {
+        cache = g_slice_new0(JsCache);
+        g_object_set_data_full(G_OBJECT(page), JS_DATA, cache,
+                (GDestroyNotify)cache_free);
+    }
+    /* The page navigated to another document since the last call. */
+    if (cache->ctx != ctx) {
+        cache_clear(cache);
+        /* Keep the context alive as long as its functions are cached, so
+         * that another context can't get the same address. */
+        cache->ctx = JSGlobalContextRetain(ctx);
+    }
+    if (cache->funcs[func]) {
+        return cache->funcs[func];
+    }
+
+    name = JSStringCreateWithUTF8CString(functions[func].name);
+    body = JSStringCreateWithUTF8CString(functions[func].body);
+    for (i = 0; i < functions[func].paramcount; i++) {
+        params[i] = JSStringCreateWithUTF8CString(functions[func].params[i]);
+    }
+
+    function = JSObjectMakeFunction(ctx, name, functions[func].paramcount,
+            params, body, NULL, 1, exception);
+
+    JSStringRelease(name);
+    JSStringRelease(body);
+    for (i = 0; i < functions[func].paramcount; i++) {
+        JSStringRelease(params[i]);
+    }
+
+    if (function) {
+        JSValueProtect(ctx, function);
+        cache->funcs[func] = function;
+    }
+
+    return function;
+}
+
+static JSValueRef variant_to_js(JSContextRef ctx, GVariant *value)
+{
+    JSStringRef str;
+    JSValueRef ref;
+
+    switch (g_variant_classify(value)) {
+        case G_VARIANT_CLASS_STRING:
+            str = JSStringCreateWithUTF8CString(g_variant_get_string(value, NULL));
+            ref = JSValueMakeString(ctx, str);
+            JSStringRelease(str);
+            return ref;
+
+        case G_VARIANT_CLASS_BOOLEAN:
+            return JSValueMakeBoolean(ctx, g_variant_get_boolean(value));
+
+        case G_VARIANT_CLASS_INT32:
+            return JSValueMakeNumber(ctx, g_variant_get_int32(value));
+
+        case G_VARIANT_CLASS_UINT32:
+            return JSValueMakeNumber(ctx, g_variant_get_uint32(value));
+
+        case G_VARIANT_CLASS_INT64:
+            return JSValueMakeNumber(ctx, g_variant_get_int64(value));
+
+        case G_VARIANT_CLASS_UINT64:
+            return JSValueMakeNumber(ctx, g_variant_get_uint64(value));
+
+        case G_VARIANT_CLASS_DOUBLE:
+            return JSValueMakeNumber(ctx, g_variant_get_double(value));
+
+        default:
+            return JSValueMakeUndefined(ctx);
+    }
+}
+
+static void cache_clear(JsCache *cache)
+{
+    guint i;
+
+    if (!cache->ctx) {
+        return;
+    }
+    for (i = 0; i < VB_JS_LAST; i++) {
+        if (cache->funcs[i]) {
+            JSValueUnprotect(cache->ctx, cache->funcs[i]);
+            cache->funcs[i] = NULL;
+        }
+    }
+    JSGlobalContextRelease(cache->ctx);
+    cache->ctx = NULL;
+}
+
+static void cache_free(JsCache *cache)
+{
+    cache_clear(cache);
+    g_slice_free(JsCache, cache);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 22, 0)
+static void on_mutations(guint changes, JSCValue *added, JSCValue *changed,
+        JsObserver *obs)
+{
+    GPtrArray *elems[2] = {NULL, NULL};
+
+    if (!obs->func) {
+        return;
+    }
+    if (jsc_value_is_array(added) && jsc_value_is_array(changed)) {
+        elems[0] = js_elements(added);
+        elems[1] = js_elements(changed);
+    }
+    obs->func(changes, elems[0], elems[1], obs->data);
+
+    if (elems[0]) {
+        g_ptr_array_free(elems[0], TRUE);
+        g_ptr_array_free(elems[1], TRUE);
+    }
+}
+
+/**
+ * Returns the DOM elements of the JavaScript array.
+ */
+static GPtrArray *js_elements(JSCValue *array)
+{
+    JSCValue *item;
+    WebKitDOMNode *node;
+    GPtrArray *elems;
+    int i, len;
+
+    item = jsc_value_object_get_property(array, "length");
+    len  = jsc_value_to_int32(item);
+    g_object_unref(item);
+
+    elems = g_ptr_array_new_full(len, g_object_unref);
+    for (i = 0; i < len; i++) {
+        item = jsc_value_object_get_property_at_index(array, i);
+        node = webkit_dom_node_for_js_value(item);
+        if (node && WEBKIT_DOM_IS_ELEMENT(node)) {
+            g_ptr_array_add(elems, g_object_ref(node));
+        }
+        g_object_unref(item);
+    }
+
+    return elems;
+}
+
+static void observer_destroy(JsObserver *obs)
+{
+    g_slice_free(JsObserver, obs);
+}
+#else
+static JSValueRef on_mutations(JSContextRef ctx, JSObjectRef function,
+        JSObjectRef this, size_t argc, const JSValueRef argv[],
+        JSValueRef *exception)
+{
+    JsObserver *obs = JSObjectGetPrivate(function);
+
+    /* The elements can't be converted to DOM objects before 2.22. */
+    if (obs && argc) {
+        obs->func((guint)JSValueToNumber(ctx, argv[0], NULL), NULL, NULL, obs->data);
+    }
+
+    return JSValueMakeUndefined(ctx);
+}
+#endif
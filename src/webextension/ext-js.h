@@ -0,0 +1,49 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef _EXT_JS_H
+#define _EXT_JS_H
+
+#include <glib.h>
+#include <webkit2/webkit-web-extension.h>
+
+/* Kinds of DOM changes reported by the mutation observer. */
+enum {
+    EXT_JS_MUTATION_ADDED     = 1 << 0,  /* elements were inserted */
+    EXT_JS_MUTATION_REMOVED   = 1 << 1,  /* nodes were removed */
+    EXT_JS_MUTATION_ATTRIBUTE = 1 << 2,  /* one of the given attributes changed */
+    EXT_JS_MUTATION_LAYOUT    = 1 << 3,  /* other attributes or text changed */
+};
+
+typedef struct JsObserver JsObserver;
+/* Gets the EXT_JS_MUTATION_* flags of the changes, the roots of the inserted
+ * subtrees and the elements with changed attributes. The elements are NULL
+ * if they are not available. */
+typedef void (*ExtJsMutationFunc)(guint changes, GPtrArray *added,
+        GPtrArray *changed, gpointer data);
+
+gboolean ext_js_call(WebKitWebPage *page, guint func, GVariant *args,
+        char **result);
+void ext_js_clear(WebKitWebPage *page);
+JsObserver *ext_js_observe_mutations(WebKitWebPage *page,
+        WebKitDOMDocument *doc, const char *attributes, guint max_nodes,
+        ExtJsMutationFunc func, gpointer data);
+void ext_js_observer_free(JsObserver *observer);
+
+#endif /* end of include guard: _EXT_JS_H */
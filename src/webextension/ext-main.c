@@ -18,29 +18,107 @@
  */
 
 #include <JavaScriptCore/JavaScript.h>
+#include <errno.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <glib.h>
 #include <libsoup/soup.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <webkit2/webkit-web-extension.h>
 
 #include "ext-main.h"
+#include "ext-block.h"
 #include "ext-dom.h"
+#include "ext-headers.h"
+#include "ext-hints.h"
+#include "ext-js.h"
 #include "ext-util.h"
 
+/* Minimum time in milliseconds between two scroll reports, about one frame. */
+#define SCROLL_REPORT_INTERVAL 16
+#define SCROLL_DATA            "vimb-scroll"
+#define FOCUS_DATA             "vimb-focus"
+#define PAGE_DATA              "vimb-page"
+
+/* Documents of a page the event observers were added to and the settings of
+ * the page. */
+typedef struct {
+    WebKitWebPage *page;
+    GHashTable    *documents;   /* documents that are still alive */
+    guint         observed;     /* number of documents observed so far */
+    HeaderRules   *headers;     /* header rules or NULL */
+    char          *main_uri;    /* main resource request including redirects */
+    guint         blocked;      /* requests blocked for the current document */
+    guint         blocked_idle_id;
+} PageData;
+
+/* Scroll position of a page last reported to the UI process. */
+typedef struct {
+    WebKitWebPage     *page;
+    WebKitDOMDocument *doc;      /* document of the last scroll event */
+    guint             timer_id;
+    gboolean          scrolled;  /* scroll events since the last report */
+    glong             max;
+    glong             top;
+    guint             percent;
+    VbScrollState     *shared;   /* memory shared with the UI process or NULL */
+    int               doorbell;  /* fd written to after shared was changed */
+} ScrollState;
+
+/* Editable focus state of a page. The focus and blur events of one main
+ * loop iteration are merged into a single report. */
+typedef struct {
+    WebKitWebPage *page;
+    guint         idle_id;
+    gboolean      reported;
+    gpointer      element;    /* active element of the last report, only
+                                 used for comparison */
+    gboolean      editable;
+    gpointer      new_element;
+    gboolean      new_editable;
+} FocusState;
+
 static gboolean on_authorize_authenticated_peer(GDBusAuthObserver *observer,
         GIOStream *stream, GCredentials *credentials, gpointer extension);
 static void on_dbus_connection_created(GObject *source_object,
         GAsyncResult *result, gpointer data);
 static void add_onload_event_observers(WebKitDOMDocument *doc,
         WebKitWebPage *page);
+static PageData *page_data_get(WebKitWebPage *page);
+static void on_document_finalized(PageData *pd, GObject *doc);
+static void page_data_free(PageData *pd);
+static gboolean is_main_resource(PageData *pd, WebKitURIRequest *request,
+        WebKitURIResponse *redirected_response);
+static void blocked_report(PageData *pd);
+static gboolean on_blocked_report_idle(PageData *pd);
+static void blocker_load(const char *dir);
+static void blocker_load_thread(GTask *task, gpointer source, char *dir,
+        GCancellable *cancellable);
+static void on_blocker_loaded(GObject *source, GAsyncResult *result,
+        gpointer data);
 static void on_document_scroll(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
         WebKitWebPage *page);
+static gboolean on_scroll_report_timeout(ScrollState *st);
+static void scroll_report(ScrollState *st, gboolean final);
+static ScrollState *scroll_state_get(WebKitWebPage *page);
+static gboolean scroll_state_share(WebKitWebPage *page, GUnixFDList *fds,
+        int state_index, int doorbell_index, GError **error);
+static void scroll_state_write(ScrollState *st);
+static void scroll_state_free(ScrollState *st);
+static gboolean on_focus_report_idle(FocusState *fs);
+static void focus_state_free(FocusState *fs);
 static void emit_page_created(GDBusConnection *connection, guint64 pageid);
 static void emit_page_created_pending(GDBusConnection *connection);
 static void queue_page_created_signal(guint64 pageid);
-static void dbus_emit_signal(const char *name, GVariant *data);
+static void dbus_emit_page_signal(WebKitWebPage *page, const char *name,
+        GVariant *data);
 static WebKitWebPage *get_web_page_or_return_dbus_error(GDBusMethodInvocation *invocation,
         WebKitWebExtension *extension, guint64 pageid);
+static void dbus_return_hints_result(GDBusMethodInvocation *invocation,
+        char *result);
+static void dbus_return_hints_seq_result(GDBusMethodInvocation *invocation,
+        char *result, guint seq);
 static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         const char *object_path, const char *interface_name, const char *method,
         GVariant *parameters, GDBusMethodInvocation *invocation, gpointer data);
@@ -76,14 +154,38 @@ static const char introspection_xml[] =
     "  <signal name='PageCreated'>"
     "   <arg type='t' name='page_id' direction='out'/>"
     "  </signal>"
+    "  <signal name='EditableFocus'>"
+    "   <arg type='b' name='editable' direction='out'/>"
+    "  </signal>"
+    "  <signal name='RequestsBlocked'>"
+    "   <arg type='u' name='count' direction='out'/>"
+    "  </signal>"
     "  <signal name='VerticalScroll'>"
     "   <arg type='t' name='page_id' direction='out'/>"
     "   <arg type='t' name='max' direction='out'/>"
     "   <arg type='q' name='percent' direction='out'/>"
     "   <arg type='t' name='top' direction='out'/>"
     "  </signal>"
-    "  <method name='SetHeaderSetting'>"
-    "   <arg type='s' name='headers' direction='in'/>"
+    "  <method name='CallJs'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='u' name='func' direction='in'/>"
+    "   <arg type='v' name='args' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "  </method>"
+    "  <method name='CallJsNoResult'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='u' name='func' direction='in'/>"
+    "   <arg type='v' name='args' direction='in'/>"
+    "  </method>"
+    "  <method name='SetScrollState'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='h' name='state' direction='in'/>"
+    "   <arg type='h' name='doorbell' direction='in'/>"
+    "  </method>"
+    "  <method name='SetHeaderRules'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='a(ssbs)' name='rules' direction='in'/>"
     "  </method>"
     "  <method name='LockInput'>"
     "   <arg type='t' name='page_id' direction='in'/>"
@@ -93,6 +195,47 @@ static const char introspection_xml[] =
     "   <arg type='t' name='page_id' direction='in'/>"
     "   <arg type='s' name='elemend_id' direction='in'/>"
     "  </method>"
+    "  <method name='HintsInit'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='y' name='mode' direction='in'/>"
+    "   <arg type='b' name='keep_open' direction='in'/>"
+    "   <arg type='u' name='max_hints' direction='in'/>"
+    "   <arg type='s' name='hint_keys' direction='in'/>"
+    "   <arg type='b' name='follow_last' direction='in'/>"
+    "   <arg type='b' name='keys_same_length' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "  </method>"
+    "  <method name='HintsFilter'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='s' name='text' direction='in'/>"
+    "   <arg type='u' name='seq' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "   <arg type='u' name='seq' direction='out'/>"
+    "  </method>"
+    "  <method name='HintsUpdate'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='s' name='key' direction='in'/>"
+    "   <arg type='u' name='seq' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "   <arg type='u' name='seq' direction='out'/>"
+    "  </method>"
+    "  <method name='HintsFocus'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='b' name='back' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "  </method>"
+    "  <method name='HintsFire'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "   <arg type='b' name='success' direction='out'/>"
+    "   <arg type='s' name='result' direction='out'/>"
+    "  </method>"
+    "  <method name='HintsClear'>"
+    "   <arg type='t' name='page_id' direction='in'/>"
+    "  </method>"
     " </interface>"
     "</node>";
 
@@ -100,9 +243,8 @@ static const char introspection_xml[] =
 struct Ext {
     guint               regid;
     GDBusConnection     *connection;
-    GHashTable          *headers;
-    GHashTable          *documents;
     GArray              *page_created_signals;
+    Blocker             *blocker;   /* set once the block lists are loaded */
 };
 struct Ext ext = {0};
 
@@ -113,14 +255,17 @@ struct Ext ext = {0};
 G_MODULE_EXPORT
 void webkit_web_extension_initialize_with_user_data(WebKitWebExtension *extension, GVariant *data)
 {
-    char *server_address;
+    char *server_address, *blocklists;
     GDBusAuthObserver *observer;
 
-    g_variant_get(data, "(m&s)", &server_address);
+    g_variant_get(data, "(m&sm&s)", &server_address, &blocklists);
     if (!server_address) {
         g_warning("UI process did not start D-Bus server");
         return;
     }
+    if (blocklists) {
+        blocker_load(blocklists);
+    }
 
     g_signal_connect(extension, "page-created", G_CALLBACK(on_page_created), NULL);
 
@@ -203,18 +348,35 @@ static void on_dbus_connection_created(GObject *source_object,
 static void add_onload_event_observers(WebKitDOMDocument *doc,
         WebKitWebPage *page)
 {
+    WebKitDOMDOMWindow *win;
     WebKitDOMEventTarget *target;
+    PageData *pd;
 
-    /* Add the document to the table of known documents or if already exists
-     * return to not apply observers multiple times. */
-    if (!g_hash_table_add(ext.documents, doc)) {
+    if (!doc) {
+        return;
+    }
+
+    /* Add the document to the table of known documents of the page or if
+     * already exists return to not apply observers multiple times. */
+    pd = page_data_get(page);
+    if (g_hash_table_contains(pd->documents, doc)) {
         return;
     }
 
     /* We have to use default view instead of the document itself in case this
      * function is called with content document of an iframe. Else the event
      * observing does not work. */
-    target = WEBKIT_DOM_EVENT_TARGET(webkit_dom_document_get_default_view(doc));
+    win = webkit_dom_document_get_default_view(doc);
+    if (!win) {
+        return;
+    }
+    target = WEBKIT_DOM_EVENT_TARGET(win);
+
+    /* The document is removed from the table when it's destroyed, which
+     * happens after the page navigated away from it. */
+    g_hash_table_add(pd->documents, doc);
+    g_object_weak_ref(G_OBJECT(doc), (GWeakNotify)on_document_finalized, pd);
+    pd->observed++;
 
     webkit_dom_event_target_add_event_listener(target, "focus",
             G_CALLBACK(on_editable_change_focus), TRUE, page);
@@ -231,60 +393,353 @@ static void add_onload_event_observers(WebKitDOMDocument *doc,
     /* Call the callback explicitly to make sure we have the right position
      * shown in statusbar also in cases the user does not scroll. */
     on_document_scroll(target, NULL, page);
+    g_object_unref(win);
+}
+
+static PageData *page_data_get(WebKitWebPage *page)
+{
+    PageData *pd;
+
+    pd = g_object_get_data(G_OBJECT(page), PAGE_DATA);
+    if (!pd) {
+        pd            = g_slice_new0(PageData);
+        pd->page      = page;
+        pd->documents = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_object_set_data_full(G_OBJECT(page), PAGE_DATA, pd,
+                (GDestroyNotify)page_data_free);
+    }
+
+    return pd;
+}
+
+static void on_document_finalized(PageData *pd, GObject *doc)
+{
+    g_hash_table_remove(pd->documents, doc);
+}
+
+static void page_data_free(PageData *pd)
+{
+    GHashTableIter iter;
+    gpointer doc;
+
+    g_debug("Page %" G_GUINT64_FORMAT " observed %u documents",
+            webkit_web_page_get_id(pd->page), pd->observed);
+
+    g_hash_table_iter_init(&iter, pd->documents);
+    while (g_hash_table_iter_next(&iter, &doc, NULL)) {
+        g_object_weak_unref(G_OBJECT(doc), (GWeakNotify)on_document_finalized, pd);
+    }
+    g_hash_table_destroy(pd->documents);
+    ext_headers_free(pd->headers);
+    g_free(pd->main_uri);
+    if (pd->blocked_idle_id) {
+        g_source_remove(pd->blocked_idle_id);
+    }
+    g_slice_free(PageData, pd);
+}
+
+/**
+ * Checks if the request loads the main resource of the page. The request of
+ * a new document has the uri of the page. The page uri is not changed by
+ * redirects, so these are followed by the uri of the redirected response.
+ * The blocked requests are counted from the start of a new document, so
+ * fragment or history changes of the page don't reset the count.
+ */
+static gboolean is_main_resource(PageData *pd, WebKitURIRequest *request,
+        WebKitURIResponse *redirected_response)
+{
+    const char *uri = webkit_uri_request_get_uri(request);
+
+    if (redirected_response) {
+        if (g_strcmp0(webkit_uri_response_get_uri(redirected_response), pd->main_uri)) {
+            return FALSE;
+        }
+    } else {
+        if (g_strcmp0(uri, webkit_web_page_get_uri(pd->page))) {
+            return FALSE;
+        }
+        if (pd->blocked) {
+            pd->blocked = 0;
+            blocked_report(pd);
+        }
+    }
+    g_free(pd->main_uri);
+    pd->main_uri = g_strdup(uri);
+
+    return TRUE;
+}
+
+/**
+ * Report the number of blocked requests to the UI process. All requests
+ * blocked within one main loop iteration are reported at once.
+ */
+static void blocked_report(PageData *pd)
+{
+    if (!pd->blocked_idle_id) {
+        pd->blocked_idle_id = g_idle_add((GSourceFunc)on_blocked_report_idle, pd);
+    }
+}
+
+static gboolean on_blocked_report_idle(PageData *pd)
+{
+    pd->blocked_idle_id = 0;
+    dbus_emit_page_signal(pd->page, "RequestsBlocked",
+            g_variant_new("(u)", pd->blocked));
+
+    return FALSE;
+}
+
+/**
+ * Load and compile the block lists of the directory in a thread, so that
+ * large lists don't delay the first page. Requests are not blocked until
+ * the lists are ready.
+ */
+static void blocker_load(const char *dir)
+{
+    GTask *task;
+
+    task = g_task_new(NULL, NULL, on_blocker_loaded, NULL);
+    g_task_set_task_data(task, g_strdup(dir), g_free);
+    g_task_run_in_thread(task, (GTaskThreadFunc)blocker_load_thread);
+    g_object_unref(task);
+}
+
+static void blocker_load_thread(GTask *task, gpointer source, char *dir,
+        GCancellable *cancellable)
+{
+    Blocker *blocker = ext_block_new();
+
+    ext_block_load_dir(blocker, dir);
+    ext_block_compile(blocker);
+    g_task_return_pointer(task, blocker, (GDestroyNotify)ext_block_free);
+}
+
+static void on_blocker_loaded(GObject *source, GAsyncResult *result,
+        gpointer data)
+{
+    ext.blocker = g_task_propagate_pointer(G_TASK(result), NULL);
+    g_debug("Loaded %u block rules", ext_block_rule_count(ext.blocker));
 }
 
 /**
  * Callback called when the document is scrolled.
+ *
+ * The position is reported at most once per SCROLL_REPORT_INTERVAL to not
+ * flood the UI process during smooth scrolling. After the scrolling stopped
+ * a final report with the exact position is sent.
  */
 static void on_document_scroll(WebKitDOMEventTarget *target, WebKitDOMEvent *event,
         WebKitWebPage *page)
 {
     WebKitDOMDocument *doc;
+    ScrollState *st;
 
     if (WEBKIT_DOM_IS_DOM_WINDOW(target)) {
         g_object_get(target, "document", &doc, NULL);
     } else {
         /* target is a doc document */
-        doc = WEBKIT_DOM_DOCUMENT(target);
+        doc = g_object_ref(WEBKIT_DOM_DOCUMENT(target));
+    }
+    if (!doc) {
+        return;
     }
 
-    if (doc) {
-        WebKitDOMElement *body, *de;
-        glong max = 0, top = 0, scrollTop, scrollHeight, clientHeight;
-        guint percent = 0;
+    st = scroll_state_get(page);
+    if (st->doc) {
+        g_object_unref(st->doc);
+    }
+    st->doc = doc;
 
-        de = webkit_dom_document_get_document_element(doc);
-        if (!de) {
-            return;
-        }
+    /* Report on the next timeout if there was a report recently. */
+    if (st->timer_id) {
+        st->scrolled = TRUE;
+        return;
+    }
 
-        body = WEBKIT_DOM_ELEMENT(webkit_dom_document_get_body(doc));
-        if (!body) {
-            return;
-        }
+    scroll_report(st, FALSE);
+    st->scrolled = FALSE;
+    st->timer_id = g_timeout_add(SCROLL_REPORT_INTERVAL,
+            (GSourceFunc)on_scroll_report_timeout, st);
+}
 
-        scrollTop = MAX(webkit_dom_element_get_scroll_top(de),
-                webkit_dom_element_get_scroll_top(body));
+static gboolean on_scroll_report_timeout(ScrollState *st)
+{
+    if (st->scrolled) {
+        scroll_report(st, FALSE);
+        st->scrolled = FALSE;
 
-        clientHeight = webkit_dom_dom_window_get_inner_height(
-                webkit_dom_document_get_default_view(doc));
+        return TRUE;
+    }
 
-        scrollHeight = MAX(webkit_dom_element_get_scroll_height(de),
-                webkit_dom_element_get_scroll_height(body));
+    /* No scroll event since the last report - scrolling stopped. */
+    scroll_report(st, TRUE);
+    st->timer_id = 0;
 
-        /* Get the maximum scrollable page size. This is the size of the whole
-         * document - height of the viewport. */
-        max = scrollHeight - clientHeight;
-        if (max > 0) {
-            percent = (guint)(0.5 + (scrollTop * 100 / max));
-            top = scrollTop;
-        }
+    return FALSE;
+}
+
+/**
+ * Emit the VerticalScroll signal if the scroll percent or maximum changed.
+ * If final is TRUE the signal is emitted also if only the scroll top
+ * changed, so that the UI process knows the exact position.
+ */
+static void scroll_report(ScrollState *st, gboolean final)
+{
+    WebKitDOMElement *body, *de;
+    WebKitDOMDOMWindow *win;
+    glong max = 0, top = 0, scrollTop, scrollHeight, clientHeight;
+    guint percent = 0;
+
+    de = webkit_dom_document_get_document_element(st->doc);
+    if (!de) {
+        return;
+    }
+
+    body = WEBKIT_DOM_ELEMENT(webkit_dom_document_get_body(st->doc));
+    if (!body) {
+        return;
+    }
+
+    win = webkit_dom_document_get_default_view(st->doc);
+    if (!win) {
+        return;
+    }
+
+    scrollTop = MAX(webkit_dom_element_get_scroll_top(de),
+            webkit_dom_element_get_scroll_top(body));
+
+    clientHeight = webkit_dom_dom_window_get_inner_height(win);
+    g_object_unref(win);
+
+    scrollHeight = MAX(webkit_dom_element_get_scroll_height(de),
+            webkit_dom_element_get_scroll_height(body));
+
+    /* Get the maximum scrollable page size. This is the size of the whole
+     * document - height of the viewport. */
+    max = scrollHeight - clientHeight;
+    if (max > 0) {
+        percent = (guint)(0.5 + (scrollTop * 100 / max));
+        top = scrollTop;
+    }
 
-        dbus_emit_signal("VerticalScroll", g_variant_new("(ttqt)",
-                webkit_web_page_get_id(page), max, percent, top));
+    if (max == st->max && percent == st->percent && (!final || top == st->top)) {
+        return;
+    }
+    st->max     = max;
+    st->percent = percent;
+    st->top     = top;
+
+    if (st->shared) {
+        scroll_state_write(st);
+        return;
+    }
+    dbus_emit_page_signal(st->page, "VerticalScroll", g_variant_new("(ttqt)",
+            webkit_web_page_get_id(st->page), max, percent, top));
+}
+
+static ScrollState *scroll_state_get(WebKitWebPage *page)
+{
+    ScrollState *st;
+
+    st = g_object_get_data(G_OBJECT(page), SCROLL_DATA);
+    if (!st) {
+        st           = g_slice_new0(ScrollState);
+        st->page     = page;
+        st->doorbell = -1;
+        g_object_set_data_full(G_OBJECT(page), SCROLL_DATA, st,
+                (GDestroyNotify)scroll_state_free);
+    }
+
+    return st;
+}
+
+/**
+ * Use the memory region and the doorbell given by the UI process to report
+ * the scroll position of the page instead of the VerticalScroll signal.
+ */
+static gboolean scroll_state_share(WebKitWebPage *page, GUnixFDList *fds,
+        int state_index, int doorbell_index, GError **error)
+{
+    ScrollState *st;
+    VbScrollState *shared;
+    int fd, doorbell;
+
+    if (!fds) {
+        g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                "No file descriptors given");
+        return FALSE;
+    }
+    fd = g_unix_fd_list_get(fds, state_index, error);
+    if (fd < 0) {
+        return FALSE;
+    }
+    doorbell = g_unix_fd_list_get(fds, doorbell_index, error);
+    if (doorbell < 0) {
+        close(fd);
+        return FALSE;
+    }
+    shared = mmap(NULL, sizeof(VbScrollState), PROT_READ|PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    /* The mapping stays valid after the fd is closed. */
+    close(fd);
+    if (shared == MAP_FAILED) {
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errno),
+                "Could not map scroll state: %s", g_strerror(errno));
+        close(doorbell);
+        return FALSE;
+    }
+
+    st = scroll_state_get(page);
+    if (st->shared) {
+        munmap(st->shared, sizeof(VbScrollState));
+        close(st->doorbell);
+    }
+    st->shared   = shared;
+    st->doorbell = doorbell;
+
+    /* Hand over the position reported so far. */
+    scroll_state_write(st);
+
+    return TRUE;
+}
+
+/**
+ * Write the current scroll position into the shared memory and ring the
+ * doorbell of the UI process.
+ */
+static void scroll_state_write(ScrollState *st)
+{
+    VbScrollState *shared = st->shared;
+    guint64 one = 1;
+
+    g_atomic_int_inc(&shared->seq);
+    shared->max     = st->max;
+    shared->percent = st->percent;
+    shared->top     = st->top;
+    g_atomic_int_inc(&shared->seq);
+
+    /* Wakeups not yet handled by the UI process are merged by the eventfd,
+     * so a full counter can be ignored. */
+    if (write(st->doorbell, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        g_warning("Could not notify scroll change: %s", g_strerror(errno));
     }
 }
 
+static void scroll_state_free(ScrollState *st)
+{
+    if (st->timer_id) {
+        g_source_remove(st->timer_id);
+    }
+    if (st->shared) {
+        munmap(st->shared, sizeof(VbScrollState));
+        close(st->doorbell);
+    }
+    if (st->doc) {
+        g_object_unref(st->doc);
+    }
+    g_slice_free(ScrollState, st);
+}
+
 /**
  * Emit the page created signal that is used in the UI process to finish the
  * dbus proxy connection.
@@ -338,27 +793,33 @@ static void queue_page_created_signal(guint64 pageid)
 }
 
 /**
- * Emits a signal over dbus.
+ * Emits a signal of the page over dbus. The signal is emitted on the object
+ * path of the page, so that the UI process can subscribe to the signals of a
+ * single page.
  *
+ * @page:   Page the signal belongs to.
  * @name:   Signal name to emit.
  * @data:   GVariant value used as value for the signal or NULL.
  */
-static void dbus_emit_signal(const char *name, GVariant *data)
+static void dbus_emit_page_signal(WebKitWebPage *page, const char *name,
+        GVariant *data)
 {
     GError *error = NULL;
+    char *path;
 
     if (!ext.connection) {
         return;
     }
 
-    /* propagate the signal over dbus */
-    g_dbus_connection_emit_signal(ext.connection, NULL,
-            VB_WEBEXTENSION_OBJECT_PATH, VB_WEBEXTENSION_INTERFACE, name,
-            data, &error);
+    path = g_strdup_printf(VB_WEBEXTENSION_PAGE_PATH "%" G_GUINT64_FORMAT,
+            webkit_web_page_get_id(page));
+    g_dbus_connection_emit_signal(ext.connection, NULL, path,
+            VB_WEBEXTENSION_INTERFACE, name, data, &error);
     if (error) {
         g_warning("Failed to emit signal '%s': %s", name, error->message);
         g_error_free(error);
     }
+    g_free(path);
 }
 
 static WebKitWebPage *get_web_page_or_return_dbus_error(GDBusMethodInvocation *invocation,
@@ -374,6 +835,29 @@ static WebKitWebPage *get_web_page_or_return_dbus_error(GDBusMethodInvocation *i
     return page;
 }
 
+/**
+ * Return the result of a hints function to the UI process and free it.
+ */
+static void dbus_return_hints_result(GDBusMethodInvocation *invocation,
+        char *result)
+{
+    g_dbus_method_invocation_return_value(invocation,
+            g_variant_new("(bs)", TRUE, result ? result : ""));
+    g_free(result);
+}
+
+/**
+ * Return the result of a hints filter function together with the sequence
+ * number of the request, so that the UI process can skip outdated results.
+ */
+static void dbus_return_hints_seq_result(GDBusMethodInvocation *invocation,
+        char *result, guint seq)
+{
+    g_dbus_method_invocation_return_value(invocation,
+            g_variant_new("(bsu)", TRUE, result ? result : "", seq));
+    g_free(result);
+}
+
 /**
  * Handle dbus method calls.
  */
@@ -413,6 +897,35 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
             g_dbus_method_invocation_return_value(invocation, g_variant_new("(bs)", success, result));
             g_free(result);
         }
+    } else if (g_str_has_prefix(method, "CallJs")) {
+        char *result = NULL;
+        gboolean success;
+        guint func;
+        GVariant *args;
+
+        g_variant_get(parameters, "(tuv)", &pageid, &func, &args);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            g_variant_unref(args);
+            return;
+        }
+        if (!g_variant_is_of_type(args, G_VARIANT_TYPE_TUPLE)) {
+            g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                    G_DBUS_ERROR_INVALID_ARGS, "Arguments must be a tuple");
+            g_variant_unref(args);
+            return;
+        }
+
+        if (!g_strcmp0(method, "CallJsNoResult")) {
+            ext_js_call(page, func, args, NULL);
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        } else {
+            success = ext_js_call(page, func, args, &result);
+            g_dbus_method_invocation_return_value(invocation,
+                    g_variant_new("(bs)", success, result ? result : ""));
+            g_free(result);
+        }
+        g_variant_unref(args);
     } else if (!g_strcmp0(method, "FocusInput")) {
         g_variant_get(parameters, "(t)", &pageid);
         page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
@@ -421,14 +934,36 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         }
         ext_dom_focus_input(webkit_web_page_get_dom_document(page));
         g_dbus_method_invocation_return_value(invocation, NULL);
-    } else if (!g_strcmp0(method, "SetHeaderSetting")) {
-        g_variant_get(parameters, "(s)", &value);
+    } else if (!g_strcmp0(method, "SetScrollState")) {
+        GUnixFDList *fds;
+        GError *error = NULL;
+        gint32 state, doorbell;
 
-        if (ext.headers) {
-            soup_header_free_param_list(ext.headers);
-            ext.headers = NULL;
+        g_variant_get(parameters, "(thh)", &pageid, &state, &doorbell);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
         }
-        ext.headers = soup_header_parse_param_list(value);
+        fds = g_dbus_message_get_unix_fd_list(g_dbus_method_invocation_get_message(invocation));
+        if (scroll_state_share(page, fds, state, doorbell, &error)) {
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        } else {
+            g_dbus_method_invocation_take_error(invocation, error);
+        }
+    } else if (!g_strcmp0(method, "SetHeaderRules")) {
+        PageData *pd;
+        GVariant *rules;
+
+        g_variant_get(parameters, "(t@a(ssbs))", &pageid, &rules);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            g_variant_unref(rules);
+            return;
+        }
+        pd = page_data_get(page);
+        ext_headers_free(pd->headers);
+        pd->headers = ext_headers_new(rules);
+        g_variant_unref(rules);
         g_dbus_method_invocation_return_value(invocation, NULL);
     } else if (!g_strcmp0(method, "LockInput")) {
         g_variant_get(parameters, "(ts)", &pageid, &value);
@@ -446,6 +981,58 @@ static void dbus_handle_method_call(GDBusConnection *conn, const char *sender,
         }
         ext_dom_unlock_input(webkit_web_page_get_dom_document(page), value);
         g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (!g_strcmp0(method, "HintsInit")) {
+        guchar mode;
+        guint max_hints;
+        gboolean keep_open, follow_last, same_length;
+        const char *keys;
+
+        g_variant_get(parameters, "(tybu&sbb)", &pageid, &mode, &keep_open,
+                &max_hints, &keys, &follow_last, &same_length);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        dbus_return_hints_result(invocation, ext_hints_init(page, mode,
+                    keep_open, max_hints, keys, follow_last, same_length));
+    } else if (!g_strcmp0(method, "HintsFilter") || !g_strcmp0(method, "HintsUpdate")) {
+        const char *text;
+        guint seq;
+
+        g_variant_get(parameters, "(t&su)", &pageid, &text, &seq);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        if (!g_strcmp0(method, "HintsFilter")) {
+            dbus_return_hints_seq_result(invocation, ext_hints_filter(page, text), seq);
+        } else {
+            dbus_return_hints_seq_result(invocation, ext_hints_update(page, text), seq);
+        }
+    } else if (!g_strcmp0(method, "HintsFocus")) {
+        gboolean back;
+
+        g_variant_get(parameters, "(tb)", &pageid, &back);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        dbus_return_hints_result(invocation, ext_hints_focus(page, back));
+    } else if (!g_strcmp0(method, "HintsFire")) {
+        g_variant_get(parameters, "(t)", &pageid);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        dbus_return_hints_result(invocation, ext_hints_fire(page));
+    } else if (!g_strcmp0(method, "HintsClear")) {
+        g_variant_get(parameters, "(t)", &pageid);
+        page = get_web_page_or_return_dbus_error(invocation, WEBKIT_WEB_EXTENSION(extension), pageid);
+        if (!page) {
+            return;
+        }
+        ext_hints_clear(page);
+        g_dbus_method_invocation_return_value(invocation, NULL);
     }
 }
 
@@ -458,23 +1045,21 @@ static void on_editable_change_focus(WebKitDOMEventTarget *target,
         WebKitDOMEvent *event, WebKitWebPage *page)
 {
     WebKitDOMDocument *doc;
-    WebKitDOMDOMWindow *dom_window;
     WebKitDOMElement *active;
-    GVariant *variant;
-    char *message;
+    FocusState *fs;
 
     if (WEBKIT_DOM_IS_DOM_WINDOW(target)) {
         g_object_get(target, "document", &doc, NULL);
+        if (!doc) {
+            return;
+        }
+        /* The page keeps the document alive. */
+        g_object_unref(doc);
     } else {
         /* target is a doc document */
         doc = WEBKIT_DOM_DOCUMENT(target);
     }
 
-    dom_window = webkit_dom_document_get_default_view(doc);
-    if (!dom_window) {
-        return;
-    }
-
     active = webkit_dom_document_get_active_element(doc);
     /* Don't do anything if there is no active element */
     if (!active) {
@@ -490,16 +1075,50 @@ static void on_editable_change_focus(WebKitDOMEventTarget *target,
         return;
     }
 
-    /* Check if the active element is an editable element. */
-    variant = g_variant_new("(tb)", webkit_web_page_get_id(page),
-            ext_dom_is_editable(active));
-    message = g_variant_print(variant, FALSE);
-    g_variant_unref(variant);
-    if (!webkit_dom_dom_window_webkit_message_handlers_post_message(dom_window, "focus", message)) {
-        g_warning("Error sending focus message");
+    fs = g_object_get_data(G_OBJECT(page), FOCUS_DATA);
+    if (!fs) {
+        fs       = g_slice_new0(FocusState);
+        fs->page = page;
+        g_object_set_data_full(G_OBJECT(page), FOCUS_DATA, fs,
+                (GDestroyNotify)focus_state_free);
+    }
+
+    /* Check if the active element is an editable element. The report is
+     * sent when the events of the current focus change are processed, so
+     * the blur and focus events of tabbing through a form lead to a single
+     * report. */
+    fs->new_element  = active;
+    fs->new_editable = ext_dom_is_editable(active);
+    if (!fs->idle_id) {
+        fs->idle_id = g_idle_add((GSourceFunc)on_focus_report_idle, fs);
+    }
+}
+
+static gboolean on_focus_report_idle(FocusState *fs)
+{
+    fs->idle_id = 0;
+
+    /* Skip the report if the same element is still focused. */
+    if (fs->reported && fs->element == fs->new_element
+            && fs->editable == fs->new_editable) {
+        return FALSE;
+    }
+    fs->reported = TRUE;
+    fs->element  = fs->new_element;
+    fs->editable = fs->new_editable;
+
+    dbus_emit_page_signal(fs->page, "EditableFocus",
+            g_variant_new("(b)", fs->editable));
+
+    return FALSE;
+}
+
+static void focus_state_free(FocusState *fs)
+{
+    if (fs->idle_id) {
+        g_source_remove(fs->idle_id);
     }
-    g_free(message);
-    g_object_unref(dom_window);
+    g_slice_free(FocusState, fs);
 }
 
 /**
@@ -526,12 +1145,8 @@ static void on_page_created(WebKitWebExtension *extension, WebKitWebPage *webpag
  */
 static void on_web_page_document_loaded(WebKitWebPage *webpage, gpointer extension)
 {
-    /* If there is a hashtable of known document - detroy this and create a
-     * new hashtable. */
-    if (ext.documents) {
-        g_hash_table_unref(ext.documents);
-    }
-    ext.documents = g_hash_table_new(g_direct_hash, g_direct_equal);
+    /* Release the JavaScript context of the previous document. */
+    ext_js_clear(webpage);
 
     add_onload_event_observers(webkit_web_page_get_dom_document(webpage), webpage);
 }
@@ -542,30 +1157,20 @@ static void on_web_page_document_loaded(WebKitWebPage *webpage, gpointer extensi
 static gboolean on_web_page_send_request(WebKitWebPage *webpage, WebKitURIRequest *request,
         WebKitURIResponse *response, gpointer extension)
 {
-    char *name, *value;
-    SoupMessageHeaders *headers;
-    GHashTableIter iter;
+    PageData *pd = page_data_get(webpage);
 
-    if (!ext.headers) {
-        return FALSE;
-    }
+    /* Cancel requests matching the block lists, but never the page the user
+     * asked for. */
+    if (!is_main_resource(pd, request, response) && ext.blocker
+            && ext_block_match(ext.blocker, webkit_uri_request_get_uri(request))) {
+        pd->blocked++;
+        blocked_report(pd);
 
-    /* Change request headers according to the users preferences. */
-    headers = webkit_uri_request_get_http_headers(request);
-    if (!headers) {
-        return FALSE;
+        return TRUE;
     }
 
-    g_hash_table_iter_init(&iter, ext.headers);
-    while (g_hash_table_iter_next(&iter, (gpointer*)&name, (gpointer*)&value)) {
-        /* Null value is used to indicate that the header should be
-         * removed completely. */
-        if (value == NULL) {
-            soup_message_headers_remove(headers, name);
-        } else {
-            soup_message_headers_replace(headers, name, value);
-        }
-    }
+    /* Change request headers according to the users preferences. */
+    ext_headers_apply(pd->headers, request);
 
     return FALSE;
 }
@@ -20,8 +20,42 @@
 #ifndef _EXT_MAIN_H
 #define _EXT_MAIN_H
 
+#include <glib.h>
+
 #define VB_WEBEXTENSION_SERVICE_NAME "org.vimb.browser.WebExtension"
 #define VB_WEBEXTENSION_OBJECT_PATH  "/org/vimb/browser/WebExtension"
 #define VB_WEBEXTENSION_INTERFACE    "org.vimb.browser.WebExtension"
+/* Object path of page related signals, followed by the page id. */
+#define VB_WEBEXTENSION_PAGE_PATH    VB_WEBEXTENSION_OBJECT_PATH "/page/"
+
+/* JavaScript functions of the web extension that can be called by the
+ * CallJs method. */
+enum {
+    VB_JS_SCROLL,               /* (mode, step, count) */
+    VB_JS_SCROLL_TO,            /* (top) */
+    VB_JS_INCREMENT_URI,        /* (count) */
+    VB_JS_BLUR_ACTIVE,
+    VB_JS_CLICK_SELECTION,
+    VB_JS_INPUT_ENTER,
+    VB_JS_INPUT_LEAVE,
+    VB_JS_INPUT_VALUE,
+    VB_JS_INPUT_ID,
+    VB_JS_EDITOR_MAP_SET,       /* (key) */
+    VB_JS_EDITOR_MAP_FOCUS,     /* (key) */
+    VB_JS_EDITOR_SET_BY_ID,     /* (id, text) */
+    VB_JS_EDITOR_SET_BY_KEY,    /* (key, text) */
+    VB_JS_LAST
+};
+
+/* Scroll position of a page in memory shared by the UI process with the web
+ * extension. Only the web extension writes it. It increments seq before and
+ * after the values are changed, so seq is odd while a write is in progress
+ * and the reader has to retry if seq changed during the read. */
+typedef struct {
+    volatile gint   seq;
+    volatile guint  percent;
+    volatile gint64 max;
+    volatile gint64 top;
+} VbScrollState;
 
 #endif /* end of include guard: _EXT_MAIN_H */
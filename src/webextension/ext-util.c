@@ -101,3 +101,18 @@ char* ext_util_js_ref_to_string(JSContextRef ctx, JSValueRef ref)
 
     return string;
 }
+
+/**
+ * Navigates the window of given JavaScript context to the uri.
+ */
+void ext_util_js_set_location(JSContextRef ctx, const char *uri)
+{
+    JSStringRef name, value;
+
+    name  = JSStringCreateWithUTF8CString("location");
+    value = JSStringCreateWithUTF8CString(uri);
+    JSObjectSetProperty(ctx, JSContextGetGlobalObject(ctx), name,
+            JSValueMakeString(ctx, value), kJSPropertyAttributeNone, NULL);
+    JSStringRelease(name);
+    JSStringRelease(value);
+}
@@ -26,5 +26,6 @@
 gboolean ext_util_create_tmp_file(const char *content, char **file);
 gboolean ext_util_js_eval(JSContextRef ctx, const char *script, JSValueRef *result);
 char* ext_util_js_ref_to_string(JSContextRef ctx, JSValueRef ref);
+void ext_util_js_set_location(JSContextRef ctx, const char *uri);
 
 #endif /* end of include guard: _EXT_UTIL_H */
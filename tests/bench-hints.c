@@ -0,0 +1,264 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+/* Measures the hinting on the given pages through hints_create() and
+ * hints_keypress() like typed by the user. For each page a JSON object with
+ * the times in milliseconds is written to stdout. Use bench-hints.sh to run
+ * it under Xvfb with the generated pages. */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/main.h>
+#include <src/ascii.h>
+#include <src/ex.h>
+#include <src/hints.h>
+
+/* Text typed to filter the hints, the pages use "link N" as link text. */
+#define FILTER_TEXT "link"
+
+typedef struct {
+    const char *name;
+    GArray     *times;
+} Series;
+
+static struct {
+    gboolean done;
+    gboolean loaded;
+    int      timeout;    /* timeout in milliseconds to wait for results */
+    int      iterations;
+    int      failures;
+} bench = {0};
+
+extern struct Vimb vb;
+
+static void on_result(Client *c, const char *result)
+{
+    bench.done = TRUE;
+}
+
+static void on_load_changed(WebKitWebView *webview, WebKitLoadEvent event,
+        gpointer data)
+{
+    if (event == WEBKIT_LOAD_FINISHED) {
+        bench.loaded = TRUE;
+    }
+}
+
+static gboolean wakeup_cb(gpointer data)
+{
+    return TRUE;
+}
+
+/**
+ * Runs the main loop until flag becomes TRUE. Returns FALSE on timeout.
+ */
+static gboolean wait_for(gboolean *flag)
+{
+    gint64 deadline = g_get_monotonic_time() + bench.timeout * 1000;
+
+    while (!*flag) {
+        if (g_get_monotonic_time() > deadline) {
+            return FALSE;
+        }
+        g_main_context_iteration(NULL, TRUE);
+    }
+    return TRUE;
+}
+
+/**
+ * Prepares to wait for the result of the next hints call and returns the
+ * start time.
+ */
+static gint64 begin(void)
+{
+    bench.done = FALSE;
+    return g_get_monotonic_time();
+}
+
+/**
+ * Waits for the result of the previous hints call and records the time
+ * since start.
+ */
+static gboolean record(Series *series, gint64 start)
+{
+    double ms;
+
+    if (!wait_for(&bench.done)) {
+        bench.failures++;
+        return FALSE;
+    }
+    ms = (g_get_monotonic_time() - start) / 1000.0;
+    g_array_append_val(series->times, ms);
+
+    return TRUE;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(double*)a, y = *(double*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void print_series(GString *out, Series *series)
+{
+    GArray *t = series->times;
+    double sum = 0;
+    guint i;
+
+    g_array_sort(t, compare_double);
+    for (i = 0; i < t->len; i++) {
+        sum += g_array_index(t, double, i);
+    }
+    g_string_append_printf(out, ",\"%s\":{\"n\":%u", series->name, t->len);
+    if (t->len) {
+        g_string_append_printf(out,
+                ",\"min\":%.3f,\"median\":%.3f,\"mean\":%.3f,\"max\":%.3f",
+                g_array_index(t, double, 0),
+                g_array_index(t, double, t->len / 2),
+                sum / t->len,
+                g_array_index(t, double, t->len - 1));
+    }
+    g_string_append_c(out, '}');
+}
+
+static void run_page(Client *c, const char *file)
+{
+    Series shown  = {"shown_ms",  g_array_new(FALSE, FALSE, sizeof(double))};
+    Series filter = {"filter_ms", g_array_new(FALSE, FALSE, sizeof(double))};
+    Series key    = {"key_ms",    g_array_new(FALSE, FALSE, sizeof(double))};
+    Series fire   = {"fire_ms",   g_array_new(FALSE, FALSE, sizeof(double))};
+    GString *out;
+    char *uri, *input;
+    gint64 start, deadline;
+    int i, len;
+
+    bench.failures = 0;
+    bench.loaded   = FALSE;
+    uri = g_filename_to_uri(file, NULL, NULL);
+    vb_load_uri(c, &(Arg){TARGET_CURRENT, uri});
+    g_free(uri);
+
+    /* Wait until the page is loaded and the web extension is connected. */
+    if (!wait_for(&bench.loaded)) {
+        printf("{\"page\":\"%s\",\"error\":\"page not loaded\"}\n", file);
+        goto out;
+    }
+    deadline = g_get_monotonic_time() + bench.timeout * 1000;
+    while (!c->dbusproxy) {
+        if (g_get_monotonic_time() > deadline) {
+            printf("{\"page\":\"%s\",\"error\":\"web extension not connected\"}\n", file);
+            goto out;
+        }
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    for (i = 0; i < bench.iterations; i++) {
+        vb_enter_prompt(c, 'c', ";y", FALSE);
+
+        start = begin();
+        hints_create(c, ";y");
+        if (!record(&shown, start)) {
+            vb_enter(c, 'n');
+            continue;
+        }
+
+        /* Type the filter text char by char. */
+        for (len = 1; len <= strlen(FILTER_TEXT); len++) {
+            input = g_strdup_printf(";y%.*s", len, FILTER_TEXT);
+            start = begin();
+            hints_create(c, input);
+            g_free(input);
+            record(&filter, start);
+        }
+
+        /* Numeric hint labels never start with 0. */
+        start = begin();
+        hints_keypress(c, '1');
+        record(&key, start);
+
+        start = begin();
+        hints_keypress(c, KEY_CR);
+        record(&fire, start);
+
+        vb_enter(c, 'n');
+    }
+
+    out = g_string_new(NULL);
+    g_string_append_printf(out, "{\"page\":\"%s\",\"iterations\":%d,\"failures\":%d",
+            file, bench.iterations, bench.failures);
+    print_series(out, &shown);
+    print_series(out, &filter);
+    print_series(out, &key);
+    print_series(out, &fire);
+    g_string_append_c(out, '}');
+    printf("%s\n", out->str);
+    fflush(stdout);
+    g_string_free(out, TRUE);
+
+out:
+    g_array_free(shown.times, TRUE);
+    g_array_free(filter.times, TRUE);
+    g_array_free(key.times, TRUE);
+    g_array_free(fire.times, TRUE);
+}
+
+int main(int argc, char *argv[])
+{
+    Client *c;
+    GError *err = NULL;
+    int i;
+
+    GOptionEntry opts[] = {
+        {"iterations", 'n', 0, G_OPTION_ARG_INT, &bench.iterations, "Number of runs per page", "N"},
+        {"timeout", 't', 0, G_OPTION_ARG_INT, &bench.timeout, "Milliseconds to wait for a result", "MS"},
+        {NULL}
+    };
+
+    bench.iterations = 10;
+    bench.timeout    = 5000;
+    if (!gtk_init_with_args(&argc, &argv, "PAGE...", opts, NULL, &err)) {
+        fprintf(stderr, "can't init gtk: %s\n", err->message);
+        g_error_free(err);
+
+        return EXIT_FAILURE;
+    }
+
+    /* Don't use the users config and don't write history. */
+    vb.configfile  = "/dev/null";
+    vb.incognito   = TRUE;
+    vb.no_maximize = TRUE;
+
+    c = vb_setup();
+    ex_run_string(c, "set hint-timeout=0", FALSE);
+    ex_run_string(c, "set hint-follow-last=off", FALSE);
+
+    hints_set_result_func(on_result);
+    g_signal_connect(c->webview, "load-changed", G_CALLBACK(on_load_changed), NULL);
+    /* Make sure the main loop wakes up to check the timeouts. */
+    g_timeout_add(50, wakeup_cb, NULL);
+
+    for (i = 1; i < argc; i++) {
+        run_page(c, argv[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
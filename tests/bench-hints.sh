@@ -0,0 +1,22 @@
+#!/bin/sh
+# Runs the hint benchmark on the generated pages under Xvfb and prints one
+# JSON object per page with the measured times in milliseconds.
+#
+# usage: bench-hints.sh [ITERATIONS]
+#
+# The bench-hints program must be build against a vimb.so that finds the web
+# extension, 'make bench' in the top directory takes care about this.
+
+cd "$(dirname "$0")" || exit 1
+
+iterations=${1:-10}
+pages=$(mktemp -d) || exit 1
+trap 'rm -rf "$pages"' EXIT INT TERM
+
+./manual/hints/gen-bench-pages.sh "$pages" || exit 1
+
+xvfb-run -a -s "-screen 0 1280x1024x24" ./bench-hints -n "$iterations" \
+    "$pages/links-1000.html" \
+    "$pages/links-10000.html" \
+    "$pages/links-50000.html" \
+    "$pages/iframes.html"
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Writes the synthetic pages used by tests/bench-hints.sh into the directory
+# given as first argument.
+#   links-1000.html, links-10000.html, links-50000.html
+#       pages with the given number of links
+#   iframes.html
+#       page with links and iframes nested four levels deep
+
+dir=${1:-.}
+mkdir -p "$dir" || exit 1
+
+# links FILE COUNT [IFRAME]
+links() {
+    {
+        printf '<html>\n<head>\n<title>%s links</title>\n</head>\n<body>\n' "$2"
+        if [ -n "$3" ]; then
+            printf '<iframe src="%s" width="90%%" height="400"></iframe>\n' "$3"
+        fi
+        awk -v n="$2" 'BEGIN {
+            for (i = 0; i < n; i++) {
+                printf "<a href=\"#l%d\">link %d</a>\n", i, i
+            }
+        }'
+        printf '</body>\n</html>\n'
+    } > "$1"
+}
+
+for n in 1000 10000 50000; do
+    links "$dir/links-$n.html" $n
+done
+
+links "$dir/frame-4.html" 200
+for level in 3 2 1; do
+    links "$dir/frame-$level.html" 200 "frame-$((level + 1)).html"
+done
+links "$dir/iframes.html" 200 frame-1.html
@@ -0,0 +1,170 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <src/webextension/ext-block.h>
+
+static Blocker *blocker = NULL;
+
+static void setup(const char *list)
+{
+    blocker = ext_block_new();
+    ext_block_add_list(blocker, list, strlen(list));
+    ext_block_compile(blocker);
+}
+
+static void teardown(void)
+{
+    ext_block_free(blocker);
+    blocker = NULL;
+}
+
+static void test_hosts(void)
+{
+    setup("# hosts file\n"
+        "127.0.0.1 localhost\n"
+        "0.0.0.0 ads.example.com tracker.example.net # comment\n"
+        ":: ipv6.example.org\n");
+
+    g_assert_cmpuint(ext_block_rule_count(blocker), ==, 3);
+    g_assert_true(ext_block_match(blocker, "http://ads.example.com/banner.png"));
+    g_assert_true(ext_block_match(blocker, "https://tracker.example.net:8080/"));
+    g_assert_true(ext_block_match(blocker, "https://ipv6.example.org/"));
+    g_assert_false(ext_block_match(blocker, "http://localhost/"));
+    g_assert_false(ext_block_match(blocker, "https://example.com/"));
+    teardown();
+}
+
+static void test_domains(void)
+{
+    setup("ads.example.com # tracker\n"
+        "plain.example.org\n"
+        "! EasyList style comment\n"
+        "||doubleclick.net^\n");
+
+    g_assert_cmpuint(ext_block_rule_count(blocker), ==, 3);
+    g_assert_true(ext_block_match(blocker, "http://ads.example.com/"));
+    g_assert_true(ext_block_match(blocker, "http://plain.example.org/x"));
+    g_assert_true(ext_block_match(blocker, "https://doubleclick.net/"));
+    g_assert_true(ext_block_match(blocker, "HTTPS://AD.DoubleClick.NET/x"));
+    g_assert_false(ext_block_match(blocker, "https://example.com/"));
+    teardown();
+}
+
+static void test_subdomains(void)
+{
+    setup("example.com\n||cdn.example.net/ads/*\n");
+
+    g_assert_true(ext_block_match(blocker, "https://www.example.com/"));
+    g_assert_true(ext_block_match(blocker, "https://a.b.example.com/"));
+    g_assert_true(ext_block_match(blocker, "https://user@www.example.com/"));
+    g_assert_true(ext_block_match(blocker, "https://img.cdn.example.net/ads/1.png"));
+    /* suffixes that don't start at a label boundary */
+    g_assert_false(ext_block_match(blocker, "https://notexample.com/"));
+    g_assert_false(ext_block_match(blocker, "https://xcdn.example.net/ads/1.png"));
+    /* the domain only in path or query */
+    g_assert_false(ext_block_match(blocker, "https://vimb.org/example.com"));
+    teardown();
+}
+
+static void test_filters(void)
+{
+    setup("/banner/*/img^\n"
+        "|https://start.example.com/\n"
+        "ad.js|\n"
+        "ab\n"
+        "/ads$script\n"
+        "/regex/\n"
+        "example.org##.ad\n");
+
+    /* short, option, regex and element hiding filters are skipped */
+    g_assert_cmpuint(ext_block_rule_count(blocker), ==, 3);
+    g_assert_true(ext_block_match(blocker, "http://vimb.org/banner/big/img/x.png"));
+    g_assert_true(ext_block_match(blocker, "http://vimb.org/banner/big/img"));
+    g_assert_false(ext_block_match(blocker, "http://vimb.org/banner/big/imgx"));
+    g_assert_true(ext_block_match(blocker, "https://start.example.com/foo"));
+    g_assert_false(ext_block_match(blocker, "http://start.example.com/foo"));
+    g_assert_true(ext_block_match(blocker, "http://vimb.org/ad.js"));
+    g_assert_false(ext_block_match(blocker, "http://vimb.org/ad.js?v=1"));
+    g_assert_false(ext_block_match(blocker, "http://vimb.org/ads"));
+    teardown();
+}
+
+static void test_stars(void)
+{
+    static char uri[5002] = "http://vimb.org/track";
+    gsize len = strlen(uri);
+
+    setup("track*a*a*a*a*a*a*a*a*a*a*x\n"
+        "||cdn.*/pix*^*gif|\n");
+
+    /* each of the parts between the '*' is searched once */
+    memset(uri + len, 'a', sizeof(uri) - len - 2);
+    g_assert_false(ext_block_match(blocker, uri));
+    uri[sizeof(uri) - 2] = 'x';
+    g_assert_true(ext_block_match(blocker, uri));
+
+    g_assert_true(ext_block_match(blocker, "https://img.cdn.vimb.org/pix/1.gif"));
+    g_assert_false(ext_block_match(blocker, "https://img.cdn.vimb.org/pix1.gif"));
+    g_assert_false(ext_block_match(blocker, "https://img.cdn.vimb.org/pix/1.gif?x"));
+    g_assert_false(ext_block_match(blocker, "https://imgcdn.vimb.org/pix/1.gif"));
+    teardown();
+}
+
+static void test_exceptions(void)
+{
+    setup("||example.com^\n"
+        "@@||good.example.com^\n"
+        "/banner/*\n"
+        "@@/banner/ok/*\n");
+
+    g_assert_true(ext_block_match(blocker, "https://example.com/"));
+    g_assert_true(ext_block_match(blocker, "https://bad.example.com/"));
+    g_assert_false(ext_block_match(blocker, "https://good.example.com/"));
+    g_assert_false(ext_block_match(blocker, "https://www.good.example.com/"));
+    g_assert_true(ext_block_match(blocker, "https://vimb.org/banner/x.png"));
+    g_assert_false(ext_block_match(blocker, "https://vimb.org/banner/ok/x.png"));
+    teardown();
+}
+
+static void test_no_host(void)
+{
+    setup("example.com\n/banner/*\n");
+
+    g_assert_false(ext_block_match(blocker, "about:blank"));
+    g_assert_false(ext_block_match(blocker, "data:text/html,/banner/"));
+    g_assert_false(ext_block_match(NULL, "https://example.com/"));
+    teardown();
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/test-block/hosts", test_hosts);
+    g_test_add_func("/test-block/domains", test_domains);
+    g_test_add_func("/test-block/subdomains", test_subdomains);
+    g_test_add_func("/test-block/filters", test_filters);
+    g_test_add_func("/test-block/stars", test_stars);
+    g_test_add_func("/test-block/exceptions", test_exceptions);
+    g_test_add_func("/test-block/no-host", test_no_host);
+
+    return g_test_run();
+}
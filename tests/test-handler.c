@@ -38,6 +38,18 @@ static void test_handler_remove(void)
     g_assert_false(handler_remove(handler, "https"));
 }
 
+static void test_handler_no_handler(void)
+{
+    g_assert_true(handler_add(handler, "magnet", "e"));
+
+    g_assert_false(handler_handle_uri(handler, TEST_URI));
+    g_assert_false(handler_handle_uri(handler, "magnetic:foo"));
+    g_assert_false(handler_handle_uri(handler, "magnet"));
+    g_assert_false(handler_handle_uri(handler, ""));
+
+    g_assert_true(handler_remove(handler, "magnet"));
+}
+
 static void test_handler_run_success(void)
 {
     if (g_test_subprocess()) {
@@ -101,6 +113,7 @@ int main(int argc, char *argv[])
 
     g_test_add_func("/test-handlers/add", test_handler_add);
     g_test_add_func("/test-handlers/remove", test_handler_remove);
+    g_test_add_func("/test-handlers/handle_uri/no-handler", test_handler_no_handler);
     g_test_add_func("/test-handlers/handle_uri/success", test_handler_run_success);
     g_test_add_func("/test-handlers/handle_uri/failed", test_handler_run_failed); 
     g_test_add_func("/test-handlers/fill-completion", test_handler_fill_completion); 
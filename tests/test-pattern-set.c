@@ -0,0 +1,116 @@
+/**
+ * vimb - a webkit based vim like browser.
+ *
+ * Copyright (C) 2012-2018 Daniel Carl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <gtk/gtk.h>
+#include <src/pattern-set.h>
+
+static PatternSet *set = NULL;
+
+static void setup(void)
+{
+    set = pattern_set_new();
+    pattern_set_add(set, "*://github.com/*", "github");
+    pattern_set_add(set, "*.com/*", "com");
+    pattern_set_add(set, "*", "all");
+    pattern_set_add(set, "http{s,}://*.example.{com,org}/*", "example");
+    pattern_set_add(set, "about:blank,*.test/*", "multi");
+}
+
+static void teardown(void)
+{
+    pattern_set_free(set);
+    set = NULL;
+}
+
+static char *match(const char *subject)
+{
+    GSList *list, *l;
+    GString *result = g_string_new(NULL);
+
+    list = pattern_set_match(set, subject);
+    for (l = list; l; l = l->next) {
+        g_string_append_printf(result, "%s%s", result->len ? " " : "", (char*)l->data);
+    }
+    g_slist_free(list);
+
+    return g_string_free(result, FALSE);
+}
+
+static void check(const char *subject, const char *expected)
+{
+    char *result = match(subject);
+    g_assert_cmpstr(result, ==, expected);
+    g_free(result);
+}
+
+static void test_match(void)
+{
+    setup();
+    check("https://github.com/fanglingsu/vimb", "github com all");
+    check("HTTPS://GitHub.COM/", "github com all");
+    check("https://www.example.com/foo", "com all example");
+    check("http://www.example.org/", "all example");
+    check("ftp://www.example.org/", "all");
+    check("about:blank", "all multi");
+    check("http://vimb.test/", "all multi");
+    check("", "all");
+    teardown();
+}
+
+static void test_remove(void)
+{
+    setup();
+    pattern_set_remove(set, "all");
+    pattern_set_remove(set, "com");
+    check("https://github.com/fanglingsu/vimb", "github");
+    check("about:blank", "multi");
+
+    /* removing unknown data does nothing */
+    pattern_set_remove(set, "unknown");
+    check("https://www.example.com/foo", "example");
+
+    pattern_set_add(set, "*.com/*", "com");
+    check("https://github.com/", "github com");
+    teardown();
+}
+
+static void test_same_fragment(void)
+{
+    set = pattern_set_new();
+    pattern_set_add(set, "http://vimb.org/*", "one");
+    pattern_set_add(set, "https://vimb.org/*", "two");
+    pattern_set_add(set, "*://vimb.org/foo", "three");
+    pattern_set_add(set, "*vimb.org/*", "four");
+
+    check("http://vimb.org/foo", "one three four");
+    check("https://vimb.org/", "two four");
+    check("https://vimb.com/", "");
+    teardown();
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/test-pattern-set/match", test_match);
+    g_test_add_func("/test-pattern-set/remove", test_remove);
+    g_test_add_func("/test-pattern-set/same-fragment", test_same_fragment);
+
+    return g_test_run();
+}
@@ -41,12 +41,14 @@ static void test_shortcut(void)
         {"zero one two three", "default:zero-two%20three"},
         /* don't remove non matched placeholders */
         {"zero", "default:zero-$2"},
-        {"_vimb3_ zero one two three four five six seven eight nine", "fullrange:zero-one-nine"}
+        {"_vimb3_ zero one two three four five six seven eight nine", "fullrange:zero-one-nine"},
+        /* gen-delims and the extra chars must not end up raw in the query */
+        {"_vimb1_ c# a?b/c@d&e+f", "only-zero:c%23%20a%3Fb%2Fc%40d%26e%2Bf"}
     };
 
     for (i = 0; i < LENGTH(data); i++) {
-        uri = shortcut_get_uri(sc, data->in);
-        g_assert_cmpstr(uri, ==, data->out);
+        uri = shortcut_get_uri(sc, data[i].in);
+        g_assert_cmpstr(uri, ==, data[i].out);
         g_free(uri);
     }
 }
@@ -81,6 +83,21 @@ static void test_shortcut_shell_param(void)
     g_free(uri);
 }
 
+static void test_shortcut_placeholder_in_param(void)
+{
+    char *uri;
+
+    /* placeholders within the params are not replaced again */
+    uri = shortcut_get_uri(sc, "_vimb7_ $1 two");
+    g_assert_cmpstr(uri, ==, "dollar:two-$1$");
+    g_free(uri);
+
+    /* shortcut without placeholders */
+    uri = shortcut_get_uri(sc, "_vimb8_ ignored");
+    g_assert_cmpstr(uri, ==, "none:$a");
+    g_free(uri);
+}
+
 static void test_shortcut_remove(void)
 {
     char *uri;
@@ -106,12 +123,15 @@ int main(int argc, char *argv[])
     g_assert_true(shortcut_add(sc, "_vimb4_", "for-remove:$0"));
     g_assert_true(shortcut_add(sc, "_vimb5_", "double-zero:$0-$0"));
     g_assert_true(shortcut_add(sc, "_vimb6_", "shell:$0-$1"));
+    g_assert_true(shortcut_add(sc, "_vimb7_", "dollar:$1-$0$"));
+    g_assert_true(shortcut_add(sc, "_vimb8_", "none:$a"));
     g_assert_true(shortcut_set_default(sc, "_vimb2_"));
 
     g_test_init(&argc, &argv, NULL);
 
     g_test_add_func("/test-shortcut/get_uri/single", test_shortcut);
     g_test_add_func("/test-shortcut/get_uri/shell-param", test_shortcut_shell_param);
+    g_test_add_func("/test-shortcut/get_uri/placeholder-in-param", test_shortcut_placeholder_in_param);
     g_test_add_func("/test-shortcut/remove", test_shortcut_remove);
 
     result = g_test_run();
@@ -246,6 +246,10 @@ static void test_wildmatch_curlybraces(void)
     g_assert_false(util_wildmatch("{foo", "{foo"));
     g_assert_false(util_wildmatch("{foo", "foo"));
     g_assert_false(util_wildmatch("foo{bar", "foo{bar"));
+
+    /* a not matching list item does not fall back to the empty item */
+    g_assert_false(util_wildmatch("{foo}bar", "bar"));
+    g_assert_false(util_wildmatch("ba{r,z}", "ba"));
 }
 
 static void test_wildmatch_complete(void)
@@ -269,6 +273,63 @@ static void test_wildmatch_multi(void)
     g_assert_false(util_wildmatch("foo,?", "fo"));
 }
 
+static void test_wildmatch_compiled(void)
+{
+    Pattern *p = util_pattern_new("*://{www.,}example.{com,org}/*,about:blank");
+
+    g_assert_true(util_pattern_match(p, "https://example.com/"));
+    g_assert_true(util_pattern_match(p, "http://www.Example.org/foo?bar"));
+    g_assert_true(util_pattern_match(p, "about:blank"));
+    /* the trailing '*' matches across '/' */
+    g_assert_true(util_pattern_match(p, "ftp://example.org/a/b/c"));
+
+    g_assert_false(util_pattern_match(p, "https://example.net/"));
+    g_assert_false(util_pattern_match(p, "https://example.com.evil/"));
+    g_assert_false(util_pattern_match(p, "about:blanks"));
+    g_assert_false(util_pattern_match(p, "https://www.example.com"));
+    g_assert_false(util_pattern_match(p, ""));
+
+    util_pattern_free(p);
+}
+
+static void test_wildmatch_perf(void)
+{
+    unsigned int i, j;
+    double time;
+    gboolean result;
+    GString *subject;
+    Pattern *p;
+    struct {
+        char *pattern;
+        char *subject;  /* the part that is repeated to build the subject */
+    } data[] = {
+        {"*a*a*a*a*a*a*a*a*b", "a"},
+        {"*://*.example.*/*?*=*&*=*x", "http://www.example.com/?utm_source=a&utm_medium=b&"},
+        {"{a,aa,aaa}*{a,aa,aaa}*{a,aa,aaa}*b", "aaa"},
+        {"*?*?*?*?*?*?*?*?/*b", "a/"},
+    };
+
+    for (i = 0; i < LENGTH(data); i++) {
+        subject = g_string_new(NULL);
+        for (j = 0; j < 4096; j++) {
+            g_string_append(subject, data[i].subject);
+        }
+        p = util_pattern_new(data[i].pattern);
+
+        g_test_timer_start();
+        for (j = 0; j < 100; j++) {
+            result = util_pattern_match(p, subject->str);
+        }
+        time = g_test_timer_elapsed();
+        g_assert_false(result);
+        g_test_minimized_result(time, "%s on %zu chars: %.3fs",
+                data[i].pattern, subject->len, time);
+
+        util_pattern_free(p);
+        g_string_free(subject, TRUE);
+    }
+}
+
 static void test_strescape(void)
 {
     unsigned int i;
@@ -315,6 +376,10 @@ int main(int argc, char *argv[])
     g_test_add_func("/test-util/wildmatch-curlybraces", test_wildmatch_curlybraces);
     g_test_add_func("/test-util/wildmatch-complete", test_wildmatch_complete);
     g_test_add_func("/test-util/wildmatch-multi", test_wildmatch_multi);
+    g_test_add_func("/test-util/wildmatch-compiled", test_wildmatch_compiled);
+    if (g_test_perf()) {
+        g_test_add_func("/test-util/wildmatch-perf", test_wildmatch_perf);
+    }
     g_test_add_func("/test-util/strescape", test_strescape);
 
     return g_test_run();